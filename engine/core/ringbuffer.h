@@ -0,0 +1,145 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file ringbuffer.h
+
+    @copyright
+    (C) 2022 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include <vector>
+
+namespace Util
+{
+    //------------------------------------------------------------------------------
+    /**
+        First in, first out queue on top of a circular array
+        Doubles its capacity when pushed to while full
+    */
+    template<typename T>
+    class RingBuffer
+    {
+    public:
+        // default constructor
+        RingBuffer(size_t initialCapacity = 64);
+
+        /// add an item at the back
+        void Push(const T& item);
+        /// remove the item at the front, returns false if empty
+        bool Pop(T& outItem);
+        /// the item at the front, must not be empty
+        const T& Front() const;
+        /// number of queued items
+        size_t Size() const;
+        /// check if empty
+        bool Empty() const;
+        /// remove all items
+        void Clear();
+
+    private:
+        void Grow();
+
+        std::vector<T> items;
+        /// index of the oldest item
+        size_t head;
+        size_t count;
+    };
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    RingBuffer<T>::RingBuffer(size_t initialCapacity) :
+        items(initialCapacity > 0 ? initialCapacity : 1),
+        head(0),
+        count(0)
+    {}
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    void
+        RingBuffer<T>::Push(const T& item)
+    {
+        if (this->count == this->items.size())
+            this->Grow();
+
+        this->items[(this->head + this->count) % this->items.size()] = item;
+        this->count++;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    bool
+        RingBuffer<T>::Pop(T& outItem)
+    {
+        if (this->count == 0)
+            return false;
+
+        outItem = this->items[this->head];
+        this->head = (this->head + 1) % this->items.size();
+        this->count--;
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    const T&
+        RingBuffer<T>::Front() const
+    {
+        return this->items[this->head];
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    size_t
+        RingBuffer<T>::Size() const
+    {
+        return this->count;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    bool
+        RingBuffer<T>::Empty() const
+    {
+        return this->count == 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    void
+        RingBuffer<T>::Clear()
+    {
+        this->head = 0;
+        this->count = 0;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+        Unwraps the items into a twice as large array, oldest first
+    */
+    template<typename T>
+    void
+        RingBuffer<T>::Grow()
+    {
+        std::vector<T> grown(this->items.size() * 2);
+        for (size_t i = 0; i < this->count; i++)
+            grown[i] = this->items[(this->head + i) % this->items.size()];
+
+        this->items.swap(grown);
+        this->head = 0;
+    }
+
+}
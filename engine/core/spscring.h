@@ -0,0 +1,103 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file spscring.h
+
+    @copyright
+    (C) 2022 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include <vector>
+#include <atomic>
+
+namespace Util
+{
+    //------------------------------------------------------------------------------
+    /**
+        Lock-free bounded queue between exactly one producer thread and one consumer thread
+        Capacity is rounded up to a power of two
+    */
+    template<typename T>
+    class SpscRing
+    {
+    public:
+        // default constructor
+        SpscRing(size_t capacity = 1024);
+
+        /// add an item, producer thread only, returns false if full
+        bool TryPush(const T& item);
+        /// remove the oldest item, consumer thread only, returns false if empty
+        bool TryPop(T& outItem);
+        /// number of queued items, only exact when called from one of the two threads while the other is idle
+        size_t Size() const;
+
+    private:
+        std::vector<T> items;
+        size_t mask;
+        /// next slot to pop, written by the consumer
+        alignas(64) std::atomic<size_t> head;
+        /// next slot to push, written by the producer
+        alignas(64) std::atomic<size_t> tail;
+    };
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    SpscRing<T>::SpscRing(size_t capacity) :
+        head(0),
+        tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        this->items.resize(size);
+        this->mask = size - 1;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    bool
+        SpscRing<T>::TryPush(const T& item)
+    {
+        const size_t currentTail = this->tail.load(std::memory_order_relaxed);
+        if (currentTail - this->head.load(std::memory_order_acquire) == this->items.size())
+            return false;
+
+        this->items[currentTail & this->mask] = item;
+        // publishes the item to the consumer
+        this->tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    bool
+        SpscRing<T>::TryPop(T& outItem)
+    {
+        const size_t currentHead = this->head.load(std::memory_order_relaxed);
+        if (currentHead == this->tail.load(std::memory_order_acquire))
+            return false;
+
+        outItem = this->items[currentHead & this->mask];
+        // hands the slot back to the producer
+        this->head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    //------------------------------------------------------------------------------
+    /**
+    */
+    template<typename T>
+    size_t
+        SpscRing<T>::Size() const
+    {
+        return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+    }
+
+}
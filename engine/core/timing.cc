@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------
+//  timing.cc
+//  (C) 2022 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "config.h"
+#include "timing.h"
+#include <thread>
+
+namespace Core
+{
+
+//------------------------------------------------------------------------------
+/**
+    The spin margin covers the scheduler granularity, which is around 1 ms on
+    Linux and up to ~15 ms on Windows unless the timer resolution is raised.
+*/
+void
+SleepUntil(std::chrono::steady_clock::time_point deadline)
+{
+#ifdef _WIN32
+    const auto spinMargin = std::chrono::milliseconds(16);
+#else
+    const auto spinMargin = std::chrono::microseconds(1500);
+#endif
+
+    auto now = std::chrono::steady_clock::now();
+    if (deadline - now > spinMargin)
+        std::this_thread::sleep_until(deadline - spinMargin);
+
+    while (std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+} // namespace Core
@@ -0,0 +1,21 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file timing.h
+
+    Contains helpers for pacing fixed-rate loops
+
+    @copyright
+    (C) 2022 Individual contributors, see AUTHORS file
+*/
+//------------------------------------------------------------------------------
+#include <chrono>
+
+namespace Core
+{
+
+/// Blocks until the deadline has passed.
+/// Sleeps for the bulk of the wait and spins for the last stretch, since OS sleeps routinely overshoot.
+void SleepUntil(std::chrono::steady_clock::time_point deadline);
+
+} // namespace Core
@@ -0,0 +1,95 @@
+#include "config.h"
+#include "broadphase.h"
+#include <algorithm>
+
+namespace Game
+{
+// the half of the 26 neighbouring cells that comes after a cell, the other half finds the same pairs from there
+static const glm::ivec3 forwardNeighbours[13] = {
+	glm::ivec3(1, -1, -1), glm::ivec3(1, -1, 0), glm::ivec3(1, -1, 1),
+	glm::ivec3(1, 0, -1), glm::ivec3(1, 0, 0), glm::ivec3(1, 0, 1),
+	glm::ivec3(1, 1, -1), glm::ivec3(1, 1, 0), glm::ivec3(1, 1, 1),
+	glm::ivec3(0, 1, -1), glm::ivec3(0, 1, 0), glm::ivec3(0, 1, 1),
+	glm::ivec3(0, 0, 1)
+};
+
+CollisionGrid::CollisionGrid() :
+	cellSize(1.f),
+	positions(nullptr)
+{}
+
+void CollisionGrid::Build(const glm::vec3* _positions, size_t count, float _cellSize)
+{
+	cellSize = glm::max(_cellSize, 0.001f);
+	positions = _positions;
+
+	entries.resize(count);
+	for (size_t i = 0; i < count; i++)
+		entries[i] = { CellKey(CellOf(positions[i])), (uint32)i };
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry& a, const Entry& b) { return a.key < b.key || (a.key == b.key && a.index < b.index); });
+}
+
+void CollisionGrid::FindPairs(float distanceSquared, std::vector<CollisionPair>& outPairs) const
+{
+	size_t first = 0;
+	while (first < entries.size())
+	{
+		uint64 key = entries[first].key;
+		size_t end = first + 1;
+		while (end < entries.size() && entries[end].key == key)
+			end++;
+
+		// pairs within the cell
+		for (size_t i = first; i < end; i++)
+			TestRuns(i, i + 1, i + 1, end, distanceSquared, outPairs);
+
+		// and with the cells after it
+		glm::ivec3 cell = CellOf(positions[entries[first].index]);
+		for (const glm::ivec3& offset : forwardNeighbours)
+		{
+			uint64 neighbourKey = CellKey(cell + offset);
+			auto it = std::lower_bound(entries.begin(), entries.end(), neighbourKey,
+				[](const Entry& e, uint64 key) { return e.key < key; });
+
+			size_t neighbourFirst = it - entries.begin();
+			size_t neighbourEnd = neighbourFirst;
+			while (neighbourEnd < entries.size() && entries[neighbourEnd].key == neighbourKey)
+				neighbourEnd++;
+
+			if (neighbourEnd > neighbourFirst)
+				TestRuns(first, end, neighbourFirst, neighbourEnd, distanceSquared, outPairs);
+		}
+
+		first = end;
+	}
+}
+
+glm::ivec3 CollisionGrid::CellOf(const glm::vec3& position) const
+{
+	return glm::ivec3(glm::floor(position / cellSize));
+}
+
+uint64 CollisionGrid::CellKey(const glm::ivec3& cell)
+{
+	// same packing as the interest grid, 21 bits per axis
+	const uint64 mask = (1ull << 21) - 1;
+	return ((uint64)(cell.x & mask) << 42) | ((uint64)(cell.y & mask) << 21) | (uint64)(cell.z & mask);
+}
+
+void CollisionGrid::TestRuns(size_t firstA, size_t endA, size_t firstB, size_t endB, float distanceSquared, std::vector<CollisionPair>& outPairs) const
+{
+	for (size_t i = firstA; i < endA; i++)
+	{
+		uint32 a = entries[i].index;
+		for (size_t j = firstB; j < endB; j++)
+		{
+			uint32 b = entries[j].index;
+			glm::vec3 diff = positions[b] - positions[a];
+			if (glm::dot(diff, diff) < distanceSquared)
+				outPairs.push_back({ glm::min(a, b), glm::max(a, b) });
+		}
+	}
+}
+}
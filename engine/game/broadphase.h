@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+
+namespace Game
+{
+struct CollisionPair
+{
+	uint32 a;// a < b, indices the grid was built with
+	uint32 b;
+};
+
+// uniform grid over positions, rebuilt every tick to find everything closer together than a distance. entities
+// are sorted by cell so that each cell is a run of the array, and each pair is found once
+class CollisionGrid
+{
+public:
+	CollisionGrid();
+
+	// cell size should be the largest distance FindPairs will be asked for, only neighbouring cells are searched
+	void Build(const glm::vec3* positions, size_t count, float _cellSize);
+	// appends every pair closer together than the distance
+	void FindPairs(float distanceSquared, std::vector<CollisionPair>& outPairs) const;
+
+private:
+	struct Entry
+	{
+		uint64 key;
+		uint32 index;
+	};
+
+	glm::ivec3 CellOf(const glm::vec3& position) const;
+	static uint64 CellKey(const glm::ivec3& cell);
+	void TestRuns(size_t firstA, size_t endA, size_t firstB, size_t endB, float distanceSquared, std::vector<CollisionPair>& outPairs) const;
+
+	float cellSize;
+	const glm::vec3* positions;// the array the grid was built from, it must outlive the queries
+	std::vector<Entry> entries;// sorted by key
+};
+}
@@ -1,5 +1,6 @@
 #include "config.h"
 #include "console.h"
+#include "netstats.h"
 #include "imgui.h"
 
 namespace Game
@@ -14,6 +15,8 @@ Console::Console(const char* _windowLabel, size_t _inputBufferSize, size_t _outp
 	outputLineCount = _outputLineCount;
 	outputBuffer = new char[outputLineCount * outputLineSize + 1];// + 1 for \0-character
 
+	netStats = nullptr;
+
 	ClearInputBuffer();
 	ClearOutputBuffer();
 }
@@ -49,6 +52,11 @@ void Console::AddOutput(const std::string& output)
 	}
 }
 
+void Console::SetNetStats(const NetStats* stats)
+{
+	netStats = stats;
+}
+
 void Console::Draw()
 {
 	ImGui::Begin(windowLabel);
@@ -64,6 +72,11 @@ void Console::Draw()
 		ReadCommand();
 	}
 
+	if (netStats != nullptr && netStats->IsPanelEnabled() && ImGui::CollapsingHeader("network"))
+	{
+		DrawNetStats();
+	}
+
 	ImGui::End();
 }
 
@@ -117,4 +130,72 @@ void Console::ReadCommand()
 
 	ClearInputBuffer();
 }
+
+void Console::DrawNetStats()
+{
+	ImGui::Text("receive queue: %zu, outbound queue: %zu", netStats->GetReceiveQueueDepth(), netStats->GetOutboundQueueDepth());
+
+	if (ImGui::BeginTable("message types", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("type");
+		ImGui::TableSetupColumn("sent/s");
+		ImGui::TableSetupColumn("sent B/s");
+		ImGui::TableSetupColumn("received/s");
+		ImGui::TableSetupColumn("received B/s");
+		ImGui::TableHeadersRow();
+
+		for (size_t i = 0; i < NetStats::maxMessageTypes; i++)
+		{
+			const MessageTypeStats& stats = netStats->GetMessageTypeStats((uint8)i);
+			if (stats.sent.packets == 0 && stats.received.packets == 0)
+				continue;
+
+			const char* name = netStats->GetMessageTypeName((uint8)i);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			if (name != nullptr)
+				ImGui::TextUnformatted(name);
+			else
+				ImGui::Text("%zu", i);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)stats.sentPerSecond.packets);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)stats.sentPerSecond.bytes);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)stats.receivedPerSecond.packets);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)stats.receivedPerSecond.bytes);
+		}
+		ImGui::EndTable();
+	}
+
+	if (ImGui::BeginTable("peers", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("peer");
+		ImGui::TableSetupColumn("rtt ms");
+		ImGui::TableSetupColumn("rtt var");
+		ImGui::TableSetupColumn("loss %");
+		ImGui::TableSetupColumn("in transit B");
+		ImGui::TableSetupColumn("queued");
+		ImGui::TableHeadersRow();
+
+		for (const PeerStats& peer : netStats->GetPeerStats())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", peer.id);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", peer.roundTripTime);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", peer.roundTripTimeVariance);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", peer.packetLoss * 100.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", peer.reliableBytesInTransit);
+			ImGui::TableNextColumn();
+			ImGui::Text("%zu", peer.queuedCommands);
+		}
+		ImGui::EndTable();
+	}
+}
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 namespace Game
 {
 typedef std::function<void(const std::string&)> ConsoleCommand;
+class NetStats;
 
 class Console
 {
@@ -19,17 +20,22 @@ private:
 	size_t outputLineSize;
 	size_t outputLineCount;
 
+	const NetStats* netStats;
+
 public:
 	Console(const char* _windowLabel, size_t _inputBufferSize, size_t _outputLineSize, size_t _outputLineCount);
 	~Console();
 
 	void SetCommand(const std::string& commandName, ConsoleCommand commandFunction);
 	void AddOutput(const std::string& output);
+	// shown below the output while net_statspanel is set, nullptr to hide
+	void SetNetStats(const NetStats* stats);
 	void Draw();
 
 private:
 	void ClearInputBuffer();
 	void ClearOutputBuffer();
 	void ReadCommand();
+	void DrawNetStats();
 };
 }
\ No newline at end of file
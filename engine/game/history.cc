@@ -0,0 +1,91 @@
+#include "config.h"
+#include "history.h"
+#include <algorithm>
+
+namespace Game
+{
+TransformHistory::TransformHistory() :
+	capacity(1),
+	firstTick(0),
+	newestTick(0),
+	tickTimes(1, 0)
+{}
+
+void TransformHistory::Resize(size_t numSlots, uint32 numTicks, uint64 tick)
+{
+	capacity = 1;
+	while (capacity < numTicks)
+		capacity <<= 1;
+
+	firstTick = tick;
+	newestTick = tick;
+	tickTimes.assign(capacity, 0);
+	positions.assign(numSlots * capacity, glm::vec3(0.f));
+	firstTicks.assign(numSlots, tick);
+}
+
+uint32 TransformHistory::GetCapacity() const
+{
+	return capacity;
+}
+
+void TransformHistory::BeginTick(uint64 tick, uint64 timeMillis)
+{
+	newestTick = tick;
+	tickTimes[tick & (capacity - 1)] = timeMillis;
+}
+
+void TransformHistory::Record(uint32 slot, const glm::vec3& position)
+{
+	positions[slot * capacity + (newestTick & (capacity - 1))] = position;
+}
+
+void TransformHistory::Reset(uint32 slot, const glm::vec3& position)
+{
+	firstTicks[slot] = newestTick;
+	Record(slot, position);
+}
+
+double TransformHistory::TickAt(uint64 timeMillis) const
+{
+	uint64 low = OldestTick();
+	uint64 high = newestTick;
+	if (timeMillis >= tickTimes[high & (capacity - 1)])
+		return (double)high;
+	if (timeMillis <= tickTimes[low & (capacity - 1)])
+		return (double)low;
+
+	// tick times only grow, so the two ticks around the time are found by bisection
+	while (high - low > 1)
+	{
+		uint64 middle = low + (high - low) / 2;
+		if (tickTimes[middle & (capacity - 1)] <= timeMillis)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	uint64 lowTime = tickTimes[low & (capacity - 1)];
+	uint64 highTime = tickTimes[high & (capacity - 1)];
+	return (double)low + (double)(timeMillis - lowTime) / (double)(highTime - lowTime);
+}
+
+glm::vec3 TransformHistory::PositionAt(uint32 slot, double tick) const
+{
+	double oldest = (double)std::max(OldestTick(), firstTicks[slot]);
+	tick = std::clamp(tick, oldest, (double)newestTick);
+
+	uint64 before = (uint64)tick;
+	const glm::vec3* ring = &positions[slot * capacity];
+	const glm::vec3& position = ring[before & (capacity - 1)];
+	if (before == newestTick)
+		return position;
+
+	return glm::mix(position, ring[(before + 1) & (capacity - 1)], (float)(tick - (double)before));
+}
+
+uint64 TransformHistory::OldestTick() const
+{
+	return newestTick >= firstTick + capacity ? newestTick - capacity + 1 : firstTick;
+}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+
+namespace Game
+{
+// where every space ship was over the last ticks, so that hits can be tested against the world a client was
+// looking at when it fired. memory is fixed once sized, a ring of positions per peer slot indexed by server tick
+class TransformHistory
+{
+public:
+	TransformHistory();
+
+	// forgets everything and starts over at a tick, slots are indexed like the server's peer slots.
+	// at least numTicks ticks are kept, rounded up to a power of two
+	void Resize(size_t numSlots, uint32 numTicks, uint64 tick);
+	uint32 GetCapacity() const;
+	// starts recording a tick, every ship is then recorded for it
+	void BeginTick(uint64 tick, uint64 timeMillis);
+	void Record(uint32 slot, const glm::vec3& position);
+	// the ship was moved without passing through the positions in between, it is treated as having always been here
+	void Reset(uint32 slot, const glm::vec3& position);
+
+	// fractional tick at a server time, clamped to the ticks kept
+	double TickAt(uint64 timeMillis) const;
+	// position at a fractional tick, linearly interpolated between the two ticks around it
+	glm::vec3 PositionAt(uint32 slot, double tick) const;
+
+private:
+	uint64 OldestTick() const;
+
+	uint32 capacity;// ticks kept, a power of two
+	uint64 firstTick;// since the last Resize
+	uint64 newestTick;
+	std::vector<uint64> tickTimes;// server time of each tick in milliseconds
+	std::vector<glm::vec3> positions;// capacity per slot
+	std::vector<uint64> firstTicks;// oldest tick that is valid for each slot
+};
+}
@@ -0,0 +1,65 @@
+#include "config.h"
+#include "interest.h"
+
+namespace Game
+{
+InterestGrid::InterestGrid() :
+	cellSize(1.f)
+{}
+
+void InterestGrid::Clear(float _cellSize)
+{
+	cellSize = glm::max(_cellSize, 0.001f);
+	cells.clear();
+	positions.clear();
+}
+
+void InterestGrid::Insert(uint32 index, const glm::vec3& position)
+{
+	if (index >= positions.size())
+		positions.resize(index + 1);
+
+	positions[index] = position;
+	cells[CellKey(CellOf(position))].push_back(index);
+}
+
+void InterestGrid::Query(const glm::vec3& center, float radius, std::vector<InterestEntry>& outEntries) const
+{
+	glm::ivec3 minCell = CellOf(center - glm::vec3(radius));
+	glm::ivec3 maxCell = CellOf(center + glm::vec3(radius));
+	float radiusSquared = radius * radius;
+
+	for (int x = minCell.x; x <= maxCell.x; x++)
+	{
+		for (int y = minCell.y; y <= maxCell.y; y++)
+		{
+			for (int z = minCell.z; z <= maxCell.z; z++)
+			{
+				auto it = cells.find(CellKey(glm::ivec3(x, y, z)));
+				if (it == cells.end())
+					continue;
+
+				for (uint32 index : it->second)
+				{
+					glm::vec3 diff = positions[index] - center;
+					float distanceSquared = glm::dot(diff, diff);
+					if (distanceSquared <= radiusSquared)
+						outEntries.push_back({ index, distanceSquared });
+				}
+			}
+		}
+	}
+}
+
+glm::ivec3 InterestGrid::CellOf(const glm::vec3& position) const
+{
+	return glm::ivec3(glm::floor(position / cellSize));
+}
+
+uint64 InterestGrid::CellKey(const glm::ivec3& cell)
+{
+	// 21 bits per axis is far more than the world will ever need
+	const uint64 mask = (1ull << 21) - 1;
+	return ((uint64)(cell.x & mask) << 42) | ((uint64)(cell.y & mask) << 21) | (uint64)(cell.z & mask);
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+namespace Game
+{
+struct InterestEntry
+{
+	uint32 index;// the index the entity was inserted with
+	float distanceSquared;// from the query center
+};
+
+// how overdue an entity is for one peer, grows every snapshot it is relevant but left out
+struct InterestPriority
+{
+	uint32 id;
+	float priority;
+};
+
+// uniform grid over entity positions, rebuilt every tick to find the entities near a point
+class InterestGrid
+{
+public:
+	InterestGrid();
+
+	// removes all entities, queries are fastest when the cell size is close to the query radius
+	void Clear(float _cellSize);
+	void Insert(uint32 index, const glm::vec3& position);
+	// appends every entity within radius of center
+	void Query(const glm::vec3& center, float radius, std::vector<InterestEntry>& outEntries) const;
+
+private:
+	glm::ivec3 CellOf(const glm::vec3& position) const;
+	static uint64 CellKey(const glm::ivec3& cell);
+
+	float cellSize;
+	std::unordered_map<uint64, std::vector<uint32>> cells;
+	std::vector<glm::vec3> positions;// indexed by entity index
+};
+}
@@ -0,0 +1,168 @@
+#include "config.h"
+#include "interpolator.h"
+
+namespace Game
+{
+// snapshots further apart than this aren't interpolated between, the entity was gone or teleported in between
+static const uint64 maxStateGapMillis = 1000;
+// how long an entity coasts on its velocity once the states run out, before it stops and waits
+static const double maxCoastMillis = 250.0;
+
+PlayoutClock::PlayoutClock()
+{
+	Reset();
+}
+
+void PlayoutClock::Reset()
+{
+	hasSnapshot = false;
+	lastServerTime = 0;
+	lastTransit = 0.0;
+	offset = 0.0;
+	jitter = 0.f;
+	interval = 50.f;
+	delay = 100.f;
+}
+
+void PlayoutClock::OnSnapshot(uint64 serverTime, uint64 localTime)
+{
+	double transit = (double)localTime - (double)serverTime;
+	if (!hasSnapshot)
+	{
+		hasSnapshot = true;
+		lastServerTime = serverTime;
+		lastTransit = transit;
+		offset = transit;
+		return;
+	}
+
+	// a late snapshot says nothing about the rate, and would count its lateness twice
+	if (serverTime <= lastServerTime)
+		return;
+
+	jitter += ((float)glm::abs(transit - lastTransit) - jitter) / 16.f;
+	interval += ((float)(serverTime - lastServerTime) - interval) / 16.f;
+	lastTransit = transit;
+	lastServerTime = serverTime;
+
+	// the fastest arrivals set the clock, so that queueing on the way doesn't drag it back. it still follows
+	// slowly when the route gets longer
+	offset = transit < offset ? transit : offset + (transit - offset) / 64.0;
+
+	// one snapshot interval to interpolate over, plus room for the usual lateness
+	float target = glm::clamp(interval + 4.f * jitter, interval, (float)maxStateGapMillis * 0.5f);
+	delay += (target - delay) * 0.1f;
+}
+
+double PlayoutClock::GetRenderTime(uint64 localTime) const
+{
+	return (double)localTime - offset - (double)delay;
+}
+
+float PlayoutClock::GetDelay() const
+{
+	return delay;
+}
+
+float PlayoutClock::GetJitter() const
+{
+	return jitter;
+}
+
+SnapshotInterpolator::SnapshotInterpolator() :
+	count(0),
+	resetTime(0)
+{}
+
+void SnapshotInterpolator::Clear()
+{
+	count = 0;
+	resetTime = 0;
+}
+
+void SnapshotInterpolator::Reset(const State& state)
+{
+	count = 0;
+	resetTime = state.time;
+	Push(state);
+}
+
+void SnapshotInterpolator::Push(const State& state)
+{
+	if (state.time < resetTime)
+		return;
+
+	if (count > 0 && state.time > states[count - 1].time + maxStateGapMillis)
+		count = 0;
+
+	uint32 index = count;
+	while (index > 0 && states[index - 1].time > state.time)
+		index--;
+
+	if (index > 0 && states[index - 1].time == state.time)
+	{
+		states[index - 1] = state;
+		return;
+	}
+
+	// full, the oldest state goes. unless this one is older still
+	if (count == capacity)
+	{
+		if (index == 0)
+			return;
+
+		for (uint32 i = 1; i < index; i++)
+			states[i - 1] = states[i];
+		states[index - 1] = state;
+		return;
+	}
+
+	for (uint32 i = count; i > index; i--)
+		states[i] = states[i - 1];
+	states[index] = state;
+	count++;
+}
+
+bool SnapshotInterpolator::Sample(double time, glm::vec3& outPosition, glm::quat& outOrientation) const
+{
+	if (count == 0)
+		return false;
+
+	const State& oldest = states[0];
+	if (time <= (double)oldest.time)
+	{
+		outPosition = oldest.position;
+		outOrientation = oldest.orientation;
+		return true;
+	}
+
+	const State& newest = states[count - 1];
+	if (time >= (double)newest.time)
+	{
+		double coast = glm::min(time - (double)newest.time, maxCoastMillis) * 0.001;
+		outPosition = newest.position + newest.velocity * (float)coast;
+		outOrientation = newest.orientation;
+		return true;
+	}
+
+	uint32 next = 1;
+	while ((double)states[next].time <= time)
+		next++;
+
+	const State& a = states[next - 1];
+	const State& b = states[next];
+	float span = (float)(b.time - a.time) * 0.001f;
+	float t = (float)((time - (double)a.time) / (double)(b.time - a.time));
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	// hermite basis, the velocities are scaled to the span so that the curve leaves and arrives at their speed
+	outPosition =
+		(2.f * t3 - 3.f * t2 + 1.f) * a.position +
+		(t3 - 2.f * t2 + t) * span * a.velocity +
+		(-2.f * t3 + 3.f * t2) * b.position +
+		(t3 - t2) * span * b.velocity;
+	outOrientation = glm::slerp(a.orientation, b.orientation, t);
+	return true;
+}
+}
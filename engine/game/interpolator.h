@@ -0,0 +1,62 @@
+#pragma once
+
+namespace Game
+{
+// when remote entities are drawn, in server time. snapshots arrive unevenly, so entities are drawn far enough
+// in the past that the next snapshot is usually there before it is needed. how far adapts to the jitter
+class PlayoutClock
+{
+public:
+	PlayoutClock();
+
+	void Reset();
+	// a snapshot taken at serverTime arrived at localTime, both in milliseconds
+	void OnSnapshot(uint64 serverTime, uint64 localTime);
+	// server time in milliseconds to draw remote entities at
+	double GetRenderTime(uint64 localTime) const;
+	// milliseconds behind the newest snapshot entities are drawn
+	float GetDelay() const;
+	float GetJitter() const;
+
+private:
+	bool hasSnapshot;
+	uint64 lastServerTime;
+	double lastTransit;// local minus server time of the last snapshot, includes the clock difference
+	double offset;// smoothed transit
+	float jitter;// smoothed change in transit between snapshots, as in RFC 3550
+	float interval;// smoothed time between snapshots
+	float delay;
+};
+
+// the states of one remote entity the server sent, sorted by time, to be sampled at the playout clock's time
+class SnapshotInterpolator
+{
+public:
+	static const uint32 capacity = 16;
+
+	struct State
+	{
+		uint64 time;// server time in milliseconds
+		glm::vec3 position;
+		glm::vec3 velocity;// units per second
+		glm::quat orientation;
+	};
+
+	SnapshotInterpolator();
+
+	void Clear();
+	// starts over from a state the entity jumped to, states from before it that arrive later are ignored
+	void Reset(const State& state);
+	// states may arrive out of order, they are put in their place. a state long after the newest one starts over
+	void Push(const State& state);
+	// position from a cubic hermite curve through the two states around the time, using their velocities as
+	// tangents, and orientation slerped between them. past the newest state the entity coasts on its velocity
+	// for a while. false if there are no states
+	bool Sample(double time, glm::vec3& outPosition, glm::quat& outOrientation) const;
+
+private:
+	State states[capacity];// oldest first
+	uint32 count;
+	uint64 resetTime;
+};
+}
@@ -1,43 +1,110 @@
 #include "config.h"
 #include "laser.h"
-#include "render/physics.h"
 
 namespace Game
 {
-Laser::Laser(const glm::vec3& _origin, const glm::quat& _orientation, uint32 _spaceShipId, uint64 _spawnTimeMillis, uint64 _despawnTimeMillis, uint32 _id) :
-	origin(_origin),
-	orientation(_orientation),
-	spaceShipId(_spaceShipId),
-	spawnTimeMillis(_spawnTimeMillis),
-	despawnTimeMillis(_despawnTimeMillis),
-	id(_id)
-{}
+size_t LaserStore::Add(uint32 id, uint32 spaceShipId, const glm::vec3& origin, const glm::quat& orientation, uint64 spawnTimeMillis, uint64 despawnTimeMillis)
+{
+	size_t index = ids.size();
+	ids.push_back(id);
+	spaceShipIds.push_back(spaceShipId);
+	origins.push_back(origin);
+	directions.push_back(orientation * glm::vec3(0.f, 0.f, 1.f));
+	orientations.push_back(orientation);
+	spawnTimes.push_back(spawnTimeMillis);
+	despawnTimes.push_back(despawnTimeMillis);
+	indices[id] = index;
+	return index;
+}
+
+void LaserStore::Remove(size_t index)
+{
+	indices.erase(ids[index]);
+
+	size_t last = ids.size() - 1;
+	if (index != last)
+	{
+		ids[index] = ids[last];
+		spaceShipIds[index] = spaceShipIds[last];
+		origins[index] = origins[last];
+		directions[index] = directions[last];
+		orientations[index] = orientations[last];
+		spawnTimes[index] = spawnTimes[last];
+		despawnTimes[index] = despawnTimes[last];
+		indices[ids[index]] = index;
+	}
 
-Laser::~Laser() {}
+	ids.pop_back();
+	spaceShipIds.pop_back();
+	origins.pop_back();
+	directions.pop_back();
+	orientations.pop_back();
+	spawnTimes.pop_back();
+	despawnTimes.pop_back();
+}
 
-float Laser::GetSecondsAlive(uint64 currentTimeMillis)
+void LaserStore::Clear()
 {
-	return 0.001f * static_cast<float>(currentTimeMillis - spawnTimeMillis);
+	ids.clear();
+	spaceShipIds.clear();
+	origins.clear();
+	directions.clear();
+	orientations.clear();
+	spawnTimes.clear();
+	despawnTimes.clear();
+	indices.clear();
 }
 
-bool Laser::ShouldDespawn(uint64 currentTimeMillis)
+size_t LaserStore::Size() const
 {
-	return currentTimeMillis > despawnTimeMillis;
+	return ids.size();
 }
 
-glm::vec3 Laser::GetCurrentPosition(uint64 currentTimeMillis, float velocity)
+size_t LaserStore::Find(uint32 id) const
 {
-	return origin + orientation * glm::vec3(0.f, 0.f, GetSecondsAlive(currentTimeMillis) * velocity);
+	auto it = indices.find(id);
+	return it != indices.end() ? it->second : ids.size();
 }
 
-glm::vec3 Laser::GetDirection()
+float LaserStore::GetSecondsAlive(size_t index, uint64 currentTimeMillis) const
 {
-	return orientation * glm::vec3(0.f, 0.f, 1.f);
+	return 0.001f * static_cast<float>(currentTimeMillis - spawnTimes[index]);
 }
 
-glm::mat4 Laser::GetLocalToWorld(uint64 currentTimeMillis, float velocity)
+bool LaserStore::ShouldDespawn(size_t index, uint64 currentTimeMillis) const
 {
-	glm::vec3 pos = GetCurrentPosition(currentTimeMillis, velocity);
-	return glm::translate(pos) * (glm::mat4)orientation;
+	return currentTimeMillis > despawnTimes[index];
+}
+
+glm::vec3 LaserStore::GetCurrentPosition(size_t index, uint64 currentTimeMillis, float velocity) const
+{
+	return origins[index] + directions[index] * (GetSecondsAlive(index, currentTimeMillis) * velocity);
+}
+
+glm::mat4 LaserStore::GetLocalToWorld(size_t index, uint64 currentTimeMillis, float velocity) const
+{
+	glm::vec3 pos = GetCurrentPosition(index, currentTimeMillis, velocity);
+	return glm::translate(pos) * (glm::mat4)orientations[index];
+}
+
+void LaserStore::GetSweeps(uint64 fromMillis, uint64 toMillis, float velocity, std::vector<glm::vec3>& outStarts, std::vector<float>& outLengths) const
+{
+	size_t count = ids.size();
+	outStarts.resize(count);
+	outLengths.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64 start = glm::max(fromMillis, spawnTimes[i]);
+		outStarts[i] = GetCurrentPosition(i, start, velocity);
+		outLengths[i] = toMillis > start ? 0.001f * static_cast<float>(toMillis - start) * velocity : 0.f;
+	}
+}
+
+bool SegmentHitsSphere(const glm::vec3& start, const glm::vec3& direction, float length, const glm::vec3& center, float radiusSquared)
+{
+	// the point of the segment closest to the center
+	float along = glm::clamp(glm::dot(center - start, direction), 0.f, length);
+	glm::vec3 diff = start + direction * along - center;
+	return glm::dot(diff, diff) <= radiusSquared;
+}
 }
-}
\ No newline at end of file
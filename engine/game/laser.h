@@ -1,24 +1,45 @@
 #pragma once
-#include "render/model.h"
+#include "glm.hpp"
+#include <vector>
+#include <unordered_map>
 
 namespace Game
 {
-struct Laser
+// every live laser, one array per field so that a tick streams through only what it needs. lasers fly straight
+// from their origin, so the direction is worked out once when they spawn. removing a laser moves the last one
+// into its place, lasers that are iterated backwards can be removed along the way
+class LaserStore
 {
-	const glm::vec3 origin;
-	const glm::quat orientation;
-	const uint64 spawnTimeMillis;
-	const uint64 despawnTimeMillis;
-	const uint32 spaceShipId;
-	const uint32 id;
+public:
+	// returns the index of the new laser
+	size_t Add(uint32 id, uint32 spaceShipId, const glm::vec3& origin, const glm::quat& orientation, uint64 spawnTimeMillis, uint64 despawnTimeMillis);
+	void Remove(size_t index);
+	void Clear();
+	size_t Size() const;
+	// index of the laser with the id, Size() if there is none
+	size_t Find(uint32 id) const;
 
-	Laser(const glm::vec3& _origin, const glm::quat& _orientation, uint32 _spaceShipId, uint64 _spawnTimeMillis, uint64 _despawnTimeMillis, uint32 _id);
-	~Laser();
+	float GetSecondsAlive(size_t index, uint64 currentTimeMillis) const;
+	bool ShouldDespawn(size_t index, uint64 currentTimeMillis) const;
+	glm::vec3 GetCurrentPosition(size_t index, uint64 currentTimeMillis, float velocity) const;
+	glm::mat4 GetLocalToWorld(size_t index, uint64 currentTimeMillis, float velocity) const;
+	// the segment every laser flew along between two times, from where it was at fromMillis, or where it spawned
+	// if that was later. indexed like the store, the segments point along directions
+	void GetSweeps(uint64 fromMillis, uint64 toMillis, float velocity, std::vector<glm::vec3>& outStarts, std::vector<float>& outLengths) const;
 
-	float GetSecondsAlive(uint64 currentTimeMillis);
-	bool ShouldDespawn(uint64 currentTimeMillis);
-	glm::vec3 GetCurrentPosition(uint64 currentTimeMillis, float velocity);
-	glm::vec3 GetDirection();
-	glm::mat4 GetLocalToWorld(uint64 currentTimeMillis, float velocity);
+	std::vector<uint32> ids;
+	std::vector<uint32> spaceShipIds;
+	std::vector<glm::vec3> origins;
+	std::vector<glm::vec3> directions;// unit length, orientation * forward
+	std::vector<glm::quat> orientations;// for drawing and sending
+	std::vector<uint64> spawnTimes;
+	std::vector<uint64> despawnTimes;
+
+private:
+	std::unordered_map<uint32, size_t> indices;// id -> index
 };
-}
\ No newline at end of file
+
+// true if a segment from start, length along a unit direction, passes within the radius of center. grazing
+// the sphere counts, and a zero length segment is just its start point
+bool SegmentHitsSphere(const glm::vec3& start, const glm::vec3& direction, float length, const glm::vec3& center, float radiusSquared);
+}
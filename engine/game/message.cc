@@ -0,0 +1,89 @@
+#include "config.h"
+#include "message.h"
+#include "network.h"
+#include <mutex>
+#include <vector>
+
+namespace Game
+{
+// big enough for everything but the game state, which grows its builder once and keeps it
+static const size_t initialBuilderSize = 1024;
+
+// sends may finish on a different thread than they started on, so the pool is shared and locked
+static std::mutex poolMutex;
+static std::vector<flatbuffers::FlatBufferBuilder*> freeBuilders;
+
+static flatbuffers::FlatBufferBuilder* AcquireBuilder()
+{
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (!freeBuilders.empty())
+		{
+			flatbuffers::FlatBufferBuilder* builder = freeBuilders.back();
+			freeBuilders.pop_back();
+			return builder;
+		}
+	}
+
+	return new flatbuffers::FlatBufferBuilder(initialBuilderSize);
+}
+
+static void ReleaseBuilder(flatbuffers::FlatBufferBuilder* builder)
+{
+	// keeps the allocated buffer for the next message
+	builder->Clear();
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	freeBuilders.push_back(builder);
+}
+
+static void OnPacketFreed(ENetPacket* packet)
+{
+	ReleaseBuilder(static_cast<flatbuffers::FlatBufferBuilder*>(packet->userData));
+}
+
+
+// --- message builder ---
+
+MessageBuilder::MessageBuilder() :
+	builder(*AcquireBuilder()),
+	packet(nullptr),
+	sentBy(nullptr)
+{}
+
+MessageBuilder::~MessageBuilder()
+{
+	if (packet == nullptr)
+	{
+		ReleaseBuilder(&builder);
+		return;
+	}
+
+	// only the thread that owns the ENet host may touch the reference count once the packet was sent
+	if (sentBy != nullptr)
+	{
+		sentBy->ReleasePacket(packet);
+		return;
+	}
+
+	// never sent, so nobody else has seen the packet
+	enet_packet_destroy(packet);
+}
+
+ENetPacket* MessageBuilder::GetPacket(Channel channel)
+{
+	if (packet != nullptr)
+		return packet;
+
+	// large state updates must stay unreliable when ENet splits them into fragments
+	enet_uint32 packetFlags = channel == Channel::State ? ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT : ENET_PACKET_FLAG_RELIABLE;
+
+	packet = enet_packet_create(builder.GetBufferPointer(), builder.GetSize(), packetFlags | ENET_PACKET_FLAG_NO_ALLOCATE);
+	packet->userData = &builder;
+	packet->freeCallback = OnPacketFreed;
+
+	// held until this message goes out of scope, so that ENet can't free it while it's still being sent
+	packet->referenceCount++;
+	return packet;
+}
+}
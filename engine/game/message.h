@@ -0,0 +1,34 @@
+#pragma once
+#include "enet/enet.h"
+#include "flatbuffers/flatbuffers.h"
+
+namespace Game
+{
+enum class Channel : enet_uint8;
+class Host;
+
+// one outbound message, built in a pooled FlatBufferBuilder whose memory is reused between messages.
+// the finished bytes are handed to ENet as they are, the builder goes back to the pool once ENet is done with them
+class MessageBuilder
+{
+public:
+	flatbuffers::FlatBufferBuilder& builder;
+
+	MessageBuilder();
+	~MessageBuilder();
+
+	MessageBuilder(const MessageBuilder&) = delete;
+	MessageBuilder& operator=(const MessageBuilder&) = delete;
+
+	// the packet that refers to the finished buffer, created on the first call.
+	// the builder must have been finished, and every call must use the same channel
+	ENetPacket* GetPacket(Channel channel);
+
+private:
+	friend class Host;
+	friend class Server;
+
+	ENetPacket* packet;
+	Host* sentBy;// the host that drops our reference to the packet, it may live on its network thread
+};
+}
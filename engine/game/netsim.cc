@@ -0,0 +1,210 @@
+#include "config.h"
+#include "netsim.h"
+#include "core/cvar.h"
+#include <algorithm>
+#include <chrono>
+
+namespace Game
+{
+static Core::CVar* net_sim_latency_ms = nullptr;
+static Core::CVar* net_sim_jitter_ms = nullptr;
+static Core::CVar* net_sim_loss = nullptr;
+static Core::CVar* net_sim_duplicate = nullptr;
+static Core::CVar* net_sim_reorder = nullptr;
+
+bool NetSimSettings::IsActive() const
+{
+	return latency > 0.f || jitter > 0.f || loss > 0.f || duplicate > 0.f || reorder > 0.f;
+}
+
+NetSim::NetSim() :
+	nextOrder(0),
+	randomState(2463534242u)
+{
+	net_sim_latency_ms = Core::CVarCreate(Core::CVar_Float, "net_sim_latency_ms", "0", "simulated latency added to everything sent and received, in milliseconds");
+	net_sim_jitter_ms = Core::CVarCreate(Core::CVar_Float, "net_sim_jitter_ms", "0", "simulated latency varies by up to this many milliseconds either way");
+	net_sim_loss = Core::CVarCreate(Core::CVar_Float, "net_sim_loss", "0", "percent of unreliable messages lost, reliable ones are delayed by a resend instead");
+	net_sim_duplicate = Core::CVarCreate(Core::CVar_Float, "net_sim_duplicate", "0", "percent of unreliable messages delivered twice");
+	net_sim_reorder = Core::CVarCreate(Core::CVar_Float, "net_sim_reorder", "0", "percent of unreliable messages received after messages sent later");
+
+	std::fill(inboundReliableDueTimes, inboundReliableDueTimes + 256, 0);
+	std::fill(outboundReliableDueTimes, outboundReliableDueTimes + 256, 0);
+}
+
+NetSim::~NetSim()
+{
+	// received packets belong to us, sent ones are shared with whoever else still holds them
+	for (const HeldMessage& held : inbound)
+		enet_packet_destroy(held.message.packet);
+
+	for (const HeldMessage& held : outbound)
+		ReleaseOutbound(held.message.packet);
+}
+
+void NetSim::Configure()
+{
+	NetSimSettings newSettings;
+	newSettings.latency = std::max(0.f, Core::CVarReadFloat(net_sim_latency_ms));
+	newSettings.jitter = std::max(0.f, Core::CVarReadFloat(net_sim_jitter_ms));
+	newSettings.loss = std::clamp(Core::CVarReadFloat(net_sim_loss), 0.f, 100.f);
+	newSettings.duplicate = std::clamp(Core::CVarReadFloat(net_sim_duplicate), 0.f, 100.f);
+	newSettings.reorder = std::clamp(Core::CVarReadFloat(net_sim_reorder), 0.f, 100.f);
+
+	std::lock_guard<std::mutex> lock(settingsMutex);
+	pendingSettings = newSettings;
+}
+
+bool NetSim::IsActive()
+{
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		settings = pendingSettings;
+	}
+
+	// whatever is held still has to come out after the simulation is turned off
+	return settings.IsActive() || !inbound.empty() || !outbound.empty();
+}
+
+void NetSim::PushInbound(const Message& message)
+{
+	uint64 dueTime;
+	bool duplicate;
+	if (!Schedule(message.packet, message.channel, inboundReliableDueTimes, true, dueTime, duplicate))
+	{
+		enet_packet_destroy(message.packet);
+		return;
+	}
+
+	Hold(inbound, dueTime, message);
+	if (duplicate)
+	{
+		// the receive queue destroys every packet it hands out, so the copy needs its own
+		ENetPacket* copy = enet_packet_create(message.packet->data, message.packet->dataLength, message.packet->flags & ~ENET_PACKET_FLAG_NO_ALLOCATE);
+		Hold(inbound, dueTime + (uint64)(1.f + RandomPercent() * 0.01f * std::max(settings.jitter, 1.f)), { message.peer, copy, message.channel });
+	}
+}
+
+void NetSim::PushOutbound(const Message& message)
+{
+	uint64 dueTime;
+	bool duplicate;
+	// never reordered here, before ENet has sequenced it a held back message would go out as the newest or be
+	// dropped as stale, but not arrive out of order. reordering is simulated on the receiving side instead
+	if (!Schedule(message.packet, message.channel, outboundReliableDueTimes, false, dueTime, duplicate))
+		return;
+
+	// ENet only takes its own reference once the packet is sent
+	message.packet->referenceCount++;
+	Hold(outbound, dueTime, message);
+	if (duplicate)
+	{
+		message.packet->referenceCount++;
+		Hold(outbound, dueTime + (uint64)(1.f + RandomPercent() * 0.01f * std::max(settings.jitter, 1.f)), message);
+	}
+}
+
+bool NetSim::PopInbound(Message& outMessage)
+{
+	return PopDue(inbound, outMessage);
+}
+
+bool NetSim::PopOutbound(Message& outMessage)
+{
+	return PopDue(outbound, outMessage);
+}
+
+void NetSim::ReleaseOutbound(ENetPacket* packet)
+{
+	packet->referenceCount--;
+	if (packet->referenceCount == 0)
+		enet_packet_destroy(packet);
+}
+
+void NetSim::DropPeer(ENetPeer* peer)
+{
+	auto isPeers = [peer](const HeldMessage& held) { return held.message.peer == peer; };
+
+	for (const HeldMessage& held : inbound)
+	{
+		if (isPeers(held))
+			enet_packet_destroy(held.message.packet);
+	}
+	inbound.erase(std::remove_if(inbound.begin(), inbound.end(), isPeers), inbound.end());
+	std::make_heap(inbound.begin(), inbound.end(), DueLater);
+
+	for (const HeldMessage& held : outbound)
+	{
+		if (isPeers(held))
+			ReleaseOutbound(held.message.packet);
+	}
+	outbound.erase(std::remove_if(outbound.begin(), outbound.end(), isPeers), outbound.end());
+	std::make_heap(outbound.begin(), outbound.end(), DueLater);
+}
+
+bool NetSim::Schedule(const ENetPacket* packet, enet_uint8 channel, uint64 reliableDueTimes[256], bool reorder, uint64& outDueTime, bool& outDuplicate)
+{
+	uint64 now = Now();
+	float jitter = settings.jitter > 0.f ? (RandomPercent() * 0.02f - 1.f) * settings.jitter : 0.f;
+	float delay = std::max(0.f, settings.latency + jitter);
+	outDuplicate = false;
+
+	if (packet->flags & ENET_PACKET_FLAG_RELIABLE)
+	{
+		// a lost reliable message is resent once ENet misses the ack, about a round trip later
+		if (RandomPercent() < settings.loss)
+			delay += 2.f * settings.latency + settings.jitter;
+
+		outDueTime = std::max(now + (uint64)delay, reliableDueTimes[channel]);
+		reliableDueTimes[channel] = outDueTime;
+		return true;
+	}
+
+	if (RandomPercent() < settings.loss)
+		return false;
+
+	// held back long enough for whatever is sent right after to overtake it
+	if (reorder && RandomPercent() < settings.reorder)
+		delay += std::max(2.f * settings.jitter, 10.f) * (0.5f + RandomPercent() * 0.01f);
+
+	outDuplicate = RandomPercent() < settings.duplicate;
+	outDueTime = now + (uint64)delay;
+	return true;
+}
+
+void NetSim::Hold(std::vector<HeldMessage>& queue, uint64 dueTime, const Message& message)
+{
+	queue.push_back({ dueTime, nextOrder++, message });
+	std::push_heap(queue.begin(), queue.end(), DueLater);
+}
+
+bool NetSim::PopDue(std::vector<HeldMessage>& queue, Message& outMessage)
+{
+	if (queue.empty() || queue.front().dueTime > Now())
+		return false;
+
+	outMessage = queue.front().message;
+	std::pop_heap(queue.begin(), queue.end(), DueLater);
+	queue.pop_back();
+	return true;
+}
+
+bool NetSim::DueLater(const HeldMessage& a, const HeldMessage& b)
+{
+	return a.dueTime != b.dueTime ? a.dueTime > b.dueTime : a.order > b.order;
+}
+
+float NetSim::RandomPercent()
+{
+	// xorshift32, the engine's generator isn't safe to call from the network thread
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return (float)(randomState >> 8) * (100.f / 16777216.f);
+}
+
+uint64 NetSim::Now()
+{
+	return (uint64)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
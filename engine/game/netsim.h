@@ -0,0 +1,80 @@
+#pragma once
+#include "enet/enet.h"
+#include <vector>
+#include <mutex>
+
+namespace Game
+{
+struct NetSimSettings
+{
+	float latency = 0.f;// milliseconds added to every message, in each direction
+	float jitter = 0.f;// milliseconds, latency varies by up to this much either way
+	float loss = 0.f;// percent of unreliable messages dropped, reliable ones arrive a resend later instead
+	float duplicate = 0.f;// percent of unreliable messages delivered twice
+	float reorder = 0.f;// percent of unreliable messages held back past the ones sent after them, on receive only
+
+	bool IsActive() const;
+};
+
+// makes a connection over localhost behave like a bad network, by holding messages back between the host and
+// ENet in both directions. reliable messages are never lost, duplicated or reordered, since ENet guarantees that.
+// everything except Configure runs on the thread that owns the ENet host
+class NetSim
+{
+public:
+	struct Message
+	{
+		ENetPeer* peer;// nullptr for broadcasts
+		ENetPacket* packet;
+		enet_uint8 channel;
+	};
+
+	NetSim();
+	~NetSim();
+
+	// reads the net_sim_ cvars, on the game thread
+	void Configure();
+	// picks up the latest settings, true while messages have to go through the simulation
+	bool IsActive();
+
+	// takes over a received packet, it comes back out of PopInbound once it is due
+	void PushInbound(const Message& message);
+	// keeps a reference to a packet that is about to be sent, it comes back out of PopOutbound once it is due
+	void PushOutbound(const Message& message);
+	bool PopInbound(Message& outMessage);
+	// the caller sends the packet and then hands it to ReleaseOutbound
+	bool PopOutbound(Message& outMessage);
+	void ReleaseOutbound(ENetPacket* packet);
+	// forgets everything held for a peer that disconnected, so that none of it reaches whoever gets the peer next
+	void DropPeer(ENetPeer* peer);
+
+private:
+	struct HeldMessage
+	{
+		uint64 dueTime;// milliseconds
+		uint64 order;// keeps messages that are due at the same time in order
+		Message message;
+	};
+
+	// false if the message is lost, otherwise the time it is due and whether it is duplicated
+	bool Schedule(const ENetPacket* packet, enet_uint8 channel, uint64 reliableDueTimes[256], bool reorder, uint64& outDueTime, bool& outDuplicate);
+	void Hold(std::vector<HeldMessage>& queue, uint64 dueTime, const Message& message);
+	bool PopDue(std::vector<HeldMessage>& queue, Message& outMessage);
+	// heap order, earliest due time on top
+	static bool DueLater(const HeldMessage& a, const HeldMessage& b);
+	float RandomPercent();
+	static uint64 Now();
+
+	std::mutex settingsMutex;
+	NetSimSettings pendingSettings;// written by Configure
+	NetSimSettings settings;// copy used by the owning thread
+
+	std::vector<HeldMessage> inbound;// min heaps on due time
+	std::vector<HeldMessage> outbound;
+	// reliable messages on a channel must come out in the order they went in, whatever the jitter
+	uint64 inboundReliableDueTimes[256];
+	uint64 outboundReliableDueTimes[256];
+	uint64 nextOrder;
+	uint32 randomState;
+};
+}
@@ -0,0 +1,248 @@
+#include "config.h"
+#include "netstats.h"
+#include "core/cvar.h"
+#include "flatbuffers/flatbuffers.h"
+
+namespace Game
+{
+static Core::CVar* net_statsdump = nullptr;
+static Core::CVar* net_statsfile = nullptr;
+static Core::CVar* net_statspanel = nullptr;
+
+uint8 MessageTypeOf(const void* data, size_t size)
+{
+	// walked by hand instead of verified, this runs for every packet
+	const uint8* bytes = static_cast<const uint8*>(data);
+	if (size < sizeof(flatbuffers::uoffset_t))
+		return 0;
+
+	size_t table = flatbuffers::ReadScalar<flatbuffers::uoffset_t>(bytes);
+	if (table + sizeof(flatbuffers::soffset_t) > size)
+		return 0;
+
+	int64 vtable = (int64)table - flatbuffers::ReadScalar<flatbuffers::soffset_t>(bytes + table);
+	if (vtable < 0 || (size_t)vtable + 3 * sizeof(flatbuffers::voffset_t) > size)
+		return 0;
+
+	// a vtable too short for the first field, or a zero offset, means the field has its default value
+	flatbuffers::voffset_t vtableSize = flatbuffers::ReadScalar<flatbuffers::voffset_t>(bytes + vtable);
+	if (vtableSize < 3 * sizeof(flatbuffers::voffset_t))
+		return 0;
+
+	flatbuffers::voffset_t field = flatbuffers::ReadScalar<flatbuffers::voffset_t>(bytes + vtable + 2 * sizeof(flatbuffers::voffset_t));
+	if (field == 0 || table + field >= size)
+		return 0;
+
+	return bytes[table + field];
+}
+
+NetStats::NetStats() :
+	messageTypeNames(nullptr),
+	receiveQueueDepth(0),
+	outboundQueueDepth(0)
+{
+	net_statsdump = Core::CVarCreate(Core::CVar_Float, "net_statsdump", "0", "seconds between network statistics dumps, 0 for none");
+	net_statsfile = Core::CVarCreate(Core::CVar_String, "net_statsfile", "netstats.csv", "where network statistics are dumped, as json lines if it ends in .json and csv otherwise");
+	net_statspanel = Core::CVarCreate(Core::CVar_Int, "net_statspanel", "1", "1 to show network statistics in the console window");
+
+	startTime = std::chrono::steady_clock::now();
+	lastSecond = startTime;
+	lastDump = startTime;
+}
+
+void NetStats::SetMessageTypeNames(const char* const* names)
+{
+	messageTypeNames = names;
+}
+
+const char* NetStats::GetMessageTypeName(uint8 messageType) const
+{
+	if (messageTypeNames == nullptr)
+		return nullptr;
+
+	// the names end at the first nullptr
+	for (size_t i = 0; i <= messageType; i++)
+	{
+		if (messageTypeNames[i] == nullptr)
+			return nullptr;
+	}
+	return messageTypeNames[messageType];
+}
+
+void NetStats::RecordSent(const ENetPacket* packet, size_t numPeers)
+{
+	MessageTypeStats& stats = messageTypes[MessageTypeOf(packet->data, packet->dataLength)];
+	stats.sent.packets += numPeers;
+	stats.sent.bytes += packet->dataLength * numPeers;
+}
+
+void NetStats::RecordReceived(const ENetPacket* packet)
+{
+	MessageTypeStats& stats = messageTypes[MessageTypeOf(packet->data, packet->dataLength)];
+	stats.received.packets++;
+	stats.received.bytes += packet->dataLength;
+}
+
+void NetStats::SamplePeers(ENetHost* host)
+{
+	std::lock_guard<std::mutex> lock(peersMutex);
+	peers.clear();
+	for (size_t i = 0; i < host->peerCount; i++)
+	{
+		ENetPeer* peer = &host->peers[i];
+		if (peer->state != ENET_PEER_STATE_CONNECTED)
+			continue;
+
+		PeerStats stats;
+		stats.id = peer->incomingPeerID;
+		stats.roundTripTime = peer->roundTripTime;
+		stats.roundTripTimeVariance = peer->roundTripTimeVariance;
+		stats.packetLoss = (float)peer->packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE;
+		stats.reliableBytesInTransit = peer->reliableDataInTransit;
+		stats.queuedCommands = enet_list_size(&peer->outgoingCommands);
+		peers.push_back(stats);
+	}
+}
+
+void NetStats::Update(size_t _receiveQueueDepth, size_t _outboundQueueDepth)
+{
+	receiveQueueDepth = _receiveQueueDepth;
+	outboundQueueDepth = _outboundQueueDepth;
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastSecond >= std::chrono::seconds(1))
+	{
+		float seconds = std::chrono::duration<float>(now - lastSecond).count();
+		for (size_t i = 0; i < maxMessageTypes; i++)
+		{
+			MessageTypeStats& stats = messageTypes[i];
+			stats.sentPerSecond.packets = (uint64)((float)(stats.sent.packets - sentAtLastSecond[i].packets) / seconds);
+			stats.sentPerSecond.bytes = (uint64)((float)(stats.sent.bytes - sentAtLastSecond[i].bytes) / seconds);
+			stats.receivedPerSecond.packets = (uint64)((float)(stats.received.packets - receivedAtLastSecond[i].packets) / seconds);
+			stats.receivedPerSecond.bytes = (uint64)((float)(stats.received.bytes - receivedAtLastSecond[i].bytes) / seconds);
+			sentAtLastSecond[i] = stats.sent;
+			receivedAtLastSecond[i] = stats.received;
+		}
+		lastSecond = now;
+	}
+
+	float dumpInterval = Core::CVarReadFloat(net_statsdump);
+	if (dumpInterval > 0.f && std::chrono::duration<float>(now - lastDump).count() >= dumpInterval)
+	{
+		if (!WriteDump(Core::CVarReadString(net_statsfile)))
+			Core::CVarWriteFloat(net_statsdump, 0.f);// don't retry a file that can't be written every tick
+
+		lastDump = now;
+	}
+}
+
+const MessageTypeStats& NetStats::GetMessageTypeStats(uint8 messageType) const
+{
+	return messageTypes[messageType];
+}
+
+std::vector<PeerStats> NetStats::GetPeerStats() const
+{
+	std::lock_guard<std::mutex> lock(peersMutex);
+	return peers;
+}
+
+size_t NetStats::GetReceiveQueueDepth() const
+{
+	return receiveQueueDepth;
+}
+
+size_t NetStats::GetOutboundQueueDepth() const
+{
+	return outboundQueueDepth;
+}
+
+bool NetStats::IsPanelEnabled() const
+{
+	return Core::CVarReadInt(net_statspanel) != 0;
+}
+
+bool NetStats::WriteDump(const char* path)
+{
+	// totals since the start, one dump appended per interval. a new path starts a new file
+	bool newFile = dumpPath != path;
+	FILE* file = fopen(path, newFile ? "w" : "a");
+	if (file == nullptr)
+	{
+		printf("\n[ERROR] failed to open network statistics file %s.\n", path);
+		return false;
+	}
+	dumpPath = path;
+
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::vector<PeerStats> peerStats = GetPeerStats();
+	size_t pathLength = strlen(path);
+	bool json = pathLength >= 5 && strcmp(path + pathLength - 5, ".json") == 0;
+
+	if (json)
+	{
+		// one object per line
+		fprintf(file, "{\"time\":%.3f,\"types\":[", time);
+		bool first = true;
+		for (size_t i = 0; i < maxMessageTypes; i++)
+		{
+			const MessageTypeStats& stats = messageTypes[i];
+			if (stats.sent.packets == 0 && stats.received.packets == 0)
+				continue;
+
+			const char* name = GetMessageTypeName((uint8)i);
+			fprintf(file, "%s{\"type\":%zu,\"name\":\"%s\",\"packetsSent\":%llu,\"bytesSent\":%llu,\"packetsReceived\":%llu,\"bytesReceived\":%llu}",
+				first ? "" : ",", i, name != nullptr ? name : "",
+				(unsigned long long)stats.sent.packets, (unsigned long long)stats.sent.bytes,
+				(unsigned long long)stats.received.packets, (unsigned long long)stats.received.bytes);
+			first = false;
+		}
+
+		fprintf(file, "],\"peers\":[");
+		for (size_t i = 0; i < peerStats.size(); i++)
+		{
+			const PeerStats& peer = peerStats[i];
+			fprintf(file, "%s{\"id\":%u,\"rtt\":%u,\"rttVariance\":%u,\"loss\":%.4f,\"reliableInTransit\":%u,\"queuedCommands\":%zu}",
+				i == 0 ? "" : ",", peer.id, peer.roundTripTime, peer.roundTripTimeVariance, peer.packetLoss,
+				peer.reliableBytesInTransit, peer.queuedCommands);
+		}
+
+		fprintf(file, "],\"receiveQueue\":%zu,\"outboundQueue\":%zu}\n", receiveQueueDepth, outboundQueueDepth);
+	}
+	else
+	{
+		// long format, one value per row, so that the columns stay the same however many peers there are
+		if (newFile)
+			fprintf(file, "time,category,name,metric,value\n");
+
+		for (size_t i = 0; i < maxMessageTypes; i++)
+		{
+			const MessageTypeStats& stats = messageTypes[i];
+			if (stats.sent.packets == 0 && stats.received.packets == 0)
+				continue;
+
+			const char* name = GetMessageTypeName((uint8)i);
+			std::string typeName = name != nullptr ? name : std::to_string(i);
+			fprintf(file, "%.3f,type,%s,packets_sent,%llu\n", time, typeName.c_str(), (unsigned long long)stats.sent.packets);
+			fprintf(file, "%.3f,type,%s,bytes_sent,%llu\n", time, typeName.c_str(), (unsigned long long)stats.sent.bytes);
+			fprintf(file, "%.3f,type,%s,packets_received,%llu\n", time, typeName.c_str(), (unsigned long long)stats.received.packets);
+			fprintf(file, "%.3f,type,%s,bytes_received,%llu\n", time, typeName.c_str(), (unsigned long long)stats.received.bytes);
+		}
+
+		for (const PeerStats& peer : peerStats)
+		{
+			fprintf(file, "%.3f,peer,%u,rtt,%u\n", time, peer.id, peer.roundTripTime);
+			fprintf(file, "%.3f,peer,%u,rtt_variance,%u\n", time, peer.id, peer.roundTripTimeVariance);
+			fprintf(file, "%.3f,peer,%u,loss,%.4f\n", time, peer.id, peer.packetLoss);
+			fprintf(file, "%.3f,peer,%u,reliable_in_transit,%u\n", time, peer.id, peer.reliableBytesInTransit);
+			fprintf(file, "%.3f,peer,%u,queued_commands,%zu\n", time, peer.id, peer.queuedCommands);
+		}
+
+		fprintf(file, "%.3f,queue,receive,depth,%zu\n", time, receiveQueueDepth);
+		fprintf(file, "%.3f,queue,outbound,depth,%zu\n", time, outboundQueueDepth);
+	}
+
+	fclose(file);
+	return true;
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "enet/enet.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+
+namespace Game
+{
+// the type of a finished message: the first field of its root table, which is how every message in proto.fbs
+// is wrapped. 0 if the buffer is too short to hold one
+uint8 MessageTypeOf(const void* data, size_t size);
+
+struct TrafficCounters
+{
+	uint64 packets = 0;
+	uint64 bytes = 0;
+};
+
+struct MessageTypeStats
+{
+	TrafficCounters sent;// one packet per receiving peer
+	TrafficCounters received;
+	TrafficCounters sentPerSecond;// over the last whole second
+	TrafficCounters receivedPerSecond;
+};
+
+struct PeerStats
+{
+	uint32 id;// ENet's incoming peer id
+	uint32 roundTripTime;// milliseconds, smoothed by ENet
+	uint32 roundTripTimeVariance;
+	float packetLoss;// fraction of reliable packets lost
+	uint32 reliableBytesInTransit;
+	size_t queuedCommands;// waiting for the next datagram
+};
+
+// what a host sent and received, fed by the host itself. everything except the peer samples is only
+// touched by the game thread
+class NetStats
+{
+public:
+	static const size_t maxMessageTypes = 256;
+
+	NetStats();
+
+	// e.g. Protocol::EnumNamesPacketType(), terminated by nullptr
+	void SetMessageTypeNames(const char* const* names);
+	const char* GetMessageTypeName(uint8 messageType) const;
+
+	void RecordSent(const ENetPacket* packet, size_t numPeers);
+	void RecordReceived(const ENetPacket* packet);
+	// on the thread that owns the host
+	void SamplePeers(ENetHost* host);
+	// updates the per second rates and writes the periodic dump, once per Host::Update
+	void Update(size_t receiveQueueDepth, size_t outboundQueueDepth);
+
+	const MessageTypeStats& GetMessageTypeStats(uint8 messageType) const;
+	std::vector<PeerStats> GetPeerStats() const;
+	size_t GetReceiveQueueDepth() const;
+	size_t GetOutboundQueueDepth() const;
+	// whether Console should draw the stats panel
+	bool IsPanelEnabled() const;
+
+private:
+	bool WriteDump(const char* path);
+
+	const char* const* messageTypeNames;
+	MessageTypeStats messageTypes[maxMessageTypes];
+	TrafficCounters sentAtLastSecond[maxMessageTypes];
+	TrafficCounters receivedAtLastSecond[maxMessageTypes];
+	size_t receiveQueueDepth;
+	size_t outboundQueueDepth;
+
+	mutable std::mutex peersMutex;
+	std::vector<PeerStats> peers;
+
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point lastSecond;
+	std::chrono::steady_clock::time_point lastDump;
+	std::string dumpPath;// the file written so far, a new one starts over
+};
+}
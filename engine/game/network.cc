@@ -16,80 +16,233 @@ bool InitializeENet()
 
 // --- data ---
 
-Data::Data()
-{
-	sender = nullptr;
-}
+Data::Data() :
+	sender(nullptr),
+	packet(nullptr),
+	channel(0)
+{}
 
-Data::Data(ENetPeer* _sender, enet_uint8* dataToCopy, size_t dataSize)
-{
-	sender = _sender;
-	data = std::make_shared<std::vector<enet_uint8>>();
-	data->reserve(dataSize);
-	for (size_t i = 0; i < dataSize; i++)
-		data->push_back(dataToCopy[i]);
-}
+Data::Data(ENetPeer* _sender, ENetPacket* _packet, enet_uint8 _channel) :
+	sender(_sender),
+	packet(_packet),
+	channel(_channel)
+{}
 
-Data::Data(const Data& other)
+const enet_uint8* Data::GetData() const
 {
-	sender = other.sender;
-	data = other.data;
+	return packet->data;
 }
 
-Data& Data::operator=(const Data& other)
+size_t Data::GetSize() const
 {
-	sender = other.sender;
-	data = other.data;
-	return *this;
+	return packet->dataLength;
 }
 
-Data::~Data() {}
-
 
 // --- host base class ---
 
 Host::Host(HostType _type) :
 	type(_type),
-	host(nullptr)
+	host(nullptr),
+	nextArrival(0),
+	receiveBatchSize(0),
+	numPoppedSinceUpdate(0),
+	numPacketsSent(0),
+	numDatagramsSent(0),
+	numBytesSent(0),
+	networkThreadRunning(false),
+	inboundEvents(4096),
+	outboundCommands(4096)
 {}
 
 Host::~Host()
 {
+	// Server and Client stop the thread while OnConnect and OnDisconnect can still be called. whatever arrived
+	// after that is only destroyed, never handled
+	JoinNetworkThread();
+	NetworkEvent event;
+	while (inboundEvents.TryPop(event))
+	{
+		if (event.type == ENET_EVENT_TYPE_RECEIVE)
+			enet_packet_destroy(event.packet);
+	}
+	ReleaseReceivedData();
+
+	QueuedData queued;
+	for (auto& queue : receiveQueues)
+	{
+		while (queue.Pop(queued))
+			enet_packet_destroy(queued.data.packet);
+	}
+
 	enet_host_destroy(host);
 }
 
+bool Host::StartNetworkThread()
+{
+	if (host == nullptr)
+	{
+		printf("\n[ERROR] tried to start the network thread without a host.\n");
+		return false;
+	}
+
+	if (IsThreaded())
+		return true;
+
+	networkThreadRunning = true;
+	networkThread = std::thread([this]() { NetworkThreadLoop(); });
+	return true;
+}
+
+void Host::StopNetworkThread()
+{
+	if (!IsThreaded())
+		return;
+
+	JoinNetworkThread();
+
+	NetworkEvent event;
+	while (inboundEvents.TryPop(event))
+		HandleEvent(event);
+}
+
+void Host::JoinNetworkThread()
+{
+	if (!IsThreaded())
+		return;
+
+	networkThreadRunning = false;
+	networkThread.join();
+
+	// the host belongs to this thread again, send whatever the network thread left behind
+	NetworkCommand command;
+	while (outboundCommands.TryPop(command))
+		ExecuteCommand(command);
+}
+
+bool Host::IsThreaded() const
+{
+	return networkThread.joinable();
+}
+
 void Host::Update()
 {
-	ENetEvent event;
-	while (enet_host_service(host, &event, 0) > 0)
+	// in case the owner didn't release the previous batch itself
+	ReleaseReceivedData();
+	numPoppedSinceUpdate = 0;
+	netSim.Configure();
+
+	if (IsThreaded())
 	{
-		switch (event.type)
-		{
-		case ENET_EVENT_TYPE_CONNECT:
-			OnConnect(event.peer);
-			break;
-		case ENET_EVENT_TYPE_RECEIVE:
-			dataStack.push_back(Data(event.peer, event.packet->data, event.packet->dataLength));
-			enet_packet_destroy(event.packet);
-			break;
-		case ENET_EVENT_TYPE_DISCONNECT:
-			OnDisconnect(event.peer);
-			break;
-		}
+		NetworkEvent event;
+		while (inboundEvents.TryPop(event))
+			HandleEvent(event);
+	}
+	else
+	{
+		ServiceHost(0, [this](const NetworkEvent& event) { HandleEvent(event); });
+		CollectHostCounters();
 	}
+
+	stats.Update(GetQueueDepth(), outboundCommands.Size());
 }
 
-bool Host::PopDataStack(Data& outData)
+void Host::Flush()
 {
-	if (dataStack.size() == 0)
+	if (host == nullptr)
+		return;
+
+	PostCommand({ NetworkCommand::Flush, nullptr, nullptr, Channel::State });
+}
+
+bool Host::PopData(Data& outData)
+{
+	if (receiveBatchSize != 0 && numPoppedSinceUpdate >= receiveBatchSize)
 		return false;
 
-	outData = dataStack.back();
-	dataStack.pop_back();
+	// the channels are ordered on their own, the oldest front among them is the next message
+	Util::RingBuffer<QueuedData>* oldest = nullptr;
+	for (auto& queue : receiveQueues)
+	{
+		if (!queue.Empty() && (oldest == nullptr || queue.Front().arrival < oldest->Front().arrival))
+			oldest = &queue;
+	}
+
+	QueuedData queued;
+	if (oldest == nullptr || !oldest->Pop(queued))
+		return false;
+
+	outData = queued.data;
+	receivedPackets.push_back(queued.data.packet);
+	numPoppedSinceUpdate++;
 	return true;
 }
 
-void Host::SendData(void* data, size_t byteSize, ENetPeer* peer, ENetPacketFlag packetFlag)
+void Host::ReleaseReceivedData()
+{
+	// received packets belong to us alone, so they can be destroyed on any thread
+	for (ENetPacket* packet : receivedPackets)
+		enet_packet_destroy(packet);
+
+	receivedPackets.clear();
+}
+
+NetStats& Host::GetStats()
+{
+	return stats;
+}
+
+SendCounters Host::GetSendCounters()
+{
+	if (!IsThreaded())
+		CollectHostCounters();
+
+	SendCounters counters;
+	counters.packets = numPacketsSent;
+	counters.datagrams = numDatagramsSent;
+	counters.bytes = numBytesSent;
+	return counters;
+}
+
+void Host::CollectHostCounters()
+{
+	if (host == nullptr)
+		return;
+
+	numDatagramsSent += host->totalSentPackets;
+	numBytesSent += host->totalSentData;
+	host->totalSentPackets = 0;
+	host->totalSentData = 0;
+}
+
+void Host::SetReceiveBatchSize(size_t maxMessages)
+{
+	receiveBatchSize = maxMessages;
+}
+
+size_t Host::GetQueueDepth() const
+{
+	size_t depth = 0;
+	for (auto& queue : receiveQueues)
+		depth += queue.Size();
+
+	return depth;
+}
+
+size_t Host::GetQueueDepth(enet_uint8 channel) const
+{
+	if (channel >= receiveQueues.size())
+		return 0;
+
+	return receiveQueues[channel].Size();
+}
+
+void Host::SetBandwidthLimit(enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+	PostCommand({ NetworkCommand::BandwidthLimit, nullptr, nullptr, Channel::State, incomingBandwidth, outgoingBandwidth });
+}
+
+void Host::SendData(MessageBuilder& message, ENetPeer* peer, Channel channel)
 {
 	if (peer == nullptr)
 	{
@@ -97,9 +250,167 @@ void Host::SendData(void* data, size_t byteSize, ENetPeer* peer, ENetPacketFlag
 		return;
 	}
 
-	ENetPacket* packet = enet_packet_create(data, byteSize, packetFlag);
-	enet_peer_send(peer, 0, packet);
-	enet_host_flush(host);
+	// queued only, goes out with the next Flush or Update
+	message.sentBy = this;
+	ENetPacket* packet = message.GetPacket(channel);
+	stats.RecordSent(packet, 1);
+	PostCommand({ NetworkCommand::Send, peer, packet, channel });
+	numPacketsSent++;
+}
+
+void Host::HandleEvent(const NetworkEvent& event)
+{
+	switch (event.type)
+	{
+	case ENET_EVENT_TYPE_CONNECT:
+		OnConnect(event.peer);
+		break;
+	case ENET_EVENT_TYPE_RECEIVE:
+		// the packet is handed out as is instead of being copied, it is destroyed on release
+		if (event.channel >= receiveQueues.size())
+			receiveQueues.resize(event.channel + 1);
+		receiveQueues[event.channel].Push({ Data(event.peer, event.packet, event.channel), nextArrival++ });
+		stats.RecordReceived(event.packet);
+		break;
+	case ENET_EVENT_TYPE_DISCONNECT:
+		OnDisconnect(event.peer);
+		break;
+	case ENET_EVENT_TYPE_NONE:
+		break;
+	}
+}
+
+void Host::PostCommand(const NetworkCommand& command)
+{
+	if (!IsThreaded())
+	{
+		ExecuteCommand(command);
+		return;
+	}
+
+	// the network thread drains the ring continuously, so it is only ever full for a moment
+	while (!outboundCommands.TryPush(command))
+		std::this_thread::yield();
+}
+
+void Host::ExecuteCommand(const NetworkCommand& command)
+{
+	switch (command.type)
+	{
+	case NetworkCommand::Send:
+		if (netSim.IsActive())
+			netSim.PushOutbound({ command.peer, command.packet, (enet_uint8)command.channel });
+		else
+			enet_peer_send(command.peer, (enet_uint8)command.channel, command.packet);
+		break;
+	case NetworkCommand::Broadcast:
+		if (netSim.IsActive())
+			netSim.PushOutbound({ nullptr, command.packet, (enet_uint8)command.channel });
+		else
+			enet_host_broadcast(host, (enet_uint8)command.channel, command.packet);
+		break;
+	case NetworkCommand::Flush:
+		enet_host_flush(host);
+		CollectHostCounters();
+		stats.SamplePeers(host);
+		break;
+	case NetworkCommand::Release:
+		// the same reference counting ENet does, so the last owner frees the packet
+		command.packet->referenceCount--;
+		if (command.packet->referenceCount == 0)
+			enet_packet_destroy(command.packet);
+		break;
+	case NetworkCommand::BandwidthLimit:
+		enet_host_bandwidth_limit(host, command.incomingBandwidth, command.outgoingBandwidth);
+		break;
+	}
+}
+
+void Host::ReleasePacket(ENetPacket* packet)
+{
+	PostCommand({ NetworkCommand::Release, nullptr, packet, Channel::State });
+}
+
+void Host::ServiceHost(enet_uint32 timeout, const std::function<void(const NetworkEvent&)>& deliver)
+{
+	bool simulating = netSim.IsActive();
+
+	ENetEvent event;
+	int result = enet_host_service(host, &event, timeout);
+	while (result > 0)
+	{
+		if (simulating && event.type == ENET_EVENT_TYPE_RECEIVE)
+		{
+			netSim.PushInbound({ event.peer, event.packet, event.channelID });
+		}
+		else
+		{
+			// connects and disconnects aren't delayed, and nothing held may outlive the connection
+			if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+				netSim.DropPeer(event.peer);
+
+			deliver({ event.type, event.peer, event.packet, event.channelID });
+		}
+
+		result = enet_host_service(host, &event, 0);
+	}
+
+	if (!simulating)
+		return;
+
+	NetSim::Message message;
+	while (netSim.PopInbound(message))
+		deliver({ ENET_EVENT_TYPE_RECEIVE, message.peer, message.packet, message.channel });
+
+	bool sent = false;
+	while (netSim.PopOutbound(message))
+	{
+		if (message.peer != nullptr)
+			enet_peer_send(message.peer, message.channel, message.packet);
+		else
+			enet_host_broadcast(host, message.channel, message.packet);
+
+		netSim.ReleaseOutbound(message.packet);
+		sent = true;
+	}
+
+	// the regular flush has already happened for these
+	if (sent)
+		enet_host_flush(host);
+}
+
+void Host::NetworkThreadLoop()
+{
+	// events the game thread has no room for yet, kept in arrival order
+	std::vector<NetworkEvent> pendingEvents;
+
+	while (networkThreadRunning)
+	{
+		NetworkCommand command;
+		while (outboundCommands.TryPop(command))
+			ExecuteCommand(command);
+
+		size_t numHandedOver = 0;
+		while (numHandedOver < pendingEvents.size() && inboundEvents.TryPush(pendingEvents[numHandedOver]))
+			numHandedOver++;
+		pendingEvents.erase(pendingEvents.begin(), pendingEvents.begin() + numHandedOver);
+
+		// wait a little for the socket, so that the thread sleeps instead of spinning when idle
+		ServiceHost(1, [this, &pendingEvents](const NetworkEvent& event)
+		{
+			if (!pendingEvents.empty() || !inboundEvents.TryPush(event))
+				pendingEvents.push_back(event);
+		});
+
+		CollectHostCounters();
+	}
+
+	// nothing may be lost when the game thread takes the host back
+	for (const NetworkEvent& event : pendingEvents)
+	{
+		while (!inboundEvents.TryPush(event))
+			std::this_thread::yield();
+	}
 }
 
 
@@ -112,9 +423,12 @@ Server::Server() :
 {}
 
 Server::~Server()
-{}
+{
+	// while OnDisconnect can still be called for the events the thread left
+	StopNetworkThread();
+}
 
-bool Server::Initialize(const char* serverIP, enet_uint16 port, ConnectionEvent _onClientConnect, ConnectionEvent _onClientDisconnect)
+bool Server::Initialize(const char* serverIP, enet_uint16 port, size_t maxPeers, ConnectionEvent _onClientConnect, ConnectionEvent _onClientDisconnect)
 {
 	onClientConnect = _onClientConnect;
 	onClientDisconnect = _onClientDisconnect;
@@ -123,7 +437,9 @@ bool Server::Initialize(const char* serverIP, enet_uint16 port, ConnectionEvent
 	enet_address_set_host(&address, serverIP);
 	address.port = port;
 
-	host = enet_host_create(&address, 32, 2, 0, 0);
+	// ENet hands out incoming peer ids below this, which is what makes them usable as slots
+	maxPeers = std::min(std::max(maxPeers, (size_t)1), (size_t)ENET_PROTOCOL_MAXIMUM_PEER_ID);
+	host = enet_host_create(&address, maxPeers, (size_t)Channel::Count, 0, 0);
 
 	if (host == nullptr)
 	{
@@ -131,43 +447,131 @@ bool Server::Initialize(const char* serverIP, enet_uint16 port, ConnectionEvent
 		return false;
 	}
 
+	peerSlots.resize(maxPeers);
+	connectedPeers.reserve(maxPeers);
+
 	printf("\n[INFO] server created.\n");
 	return true;
 }
 
-void Server::BroadcastData(void* data, size_t byteSize, ENetPacketFlag packetFlag, ENetPeer* exlude)
+size_t Server::GetMaxPeers() const
+{
+	return peerSlots.size();
+}
+
+uint32 Server::SlotOf(const ENetPeer* peer)
+{
+	return peer->incomingPeerID;
+}
+
+bool Server::IsConnected(const ENetPeer* peer) const
+{
+	uint32 slot = SlotOf(peer);
+	return slot < peerSlots.size() && peerSlots[slot].peer == peer;
+}
+
+ENetPeer* Server::GetPeer(uint32 slot) const
 {
-	ENetPacket* packet = enet_packet_create(data, byteSize, packetFlag);
+	return slot < peerSlots.size() ? peerSlots[slot].peer : nullptr;
+}
+
+void Server::SendData(MessageBuilder& message, ENetPeer* peer, Channel channel)
+{
+	if (IsConnected(peer))
+		peerSlots[SlotOf(peer)].sendBudget -= (int64)message.GetPacket(channel)->dataLength;
+
+	Host::SendData(message, peer, channel);
+}
+
+void Server::BroadcastData(MessageBuilder& message, Channel channel, ENetPeer* exlude)
+{
+	ENetPacket* packet = message.GetPacket(channel);
+	message.sentBy = this;
+
+	for (ENetPeer* peer : connectedPeers)
+	{
+		if (peer != exlude)
+			peerSlots[SlotOf(peer)].sendBudget -= (int64)packet->dataLength;
+	}
+	stats.RecordSent(packet, exlude != nullptr && IsConnected(exlude) ? connectedPeers.size() - 1 : connectedPeers.size());
 
 	if (exlude == nullptr)
 	{
-		enet_host_broadcast(host, 0, packet);
+		PostCommand({ NetworkCommand::Broadcast, nullptr, packet, channel });
+		numPacketsSent += connectedPeers.size();
 	}
 	else
 	{
 		for (auto& peer : connectedPeers)
 		{
-			if(peer != exlude)
-				enet_peer_send(peer, 0, packet);
+			if (peer != exlude)
+			{
+				PostCommand({ NetworkCommand::Send, peer, packet, channel });
+				numPacketsSent++;
+			}
 		}
 	}
-
-	enet_host_flush(host);
 }
 
-void Server::OnConnect(ENetPeer* peer)
+void Server::RefillSendBudgets(size_t bytesPerSecond, float deltaTime, size_t maxBurst)
 {
-	if (connectedPeers.count(peer) == 0)
+	for (ENetPeer* peer : connectedPeers)
 	{
-		connectedPeers.insert(peer);
-		onClientConnect(peer);
+		PeerSlot& slot = peerSlots[SlotOf(peer)];
+		if (bytesPerSecond == 0)
+			slot.sendBudget = std::numeric_limits<int32>::max();
+		else
+			slot.sendBudget = std::min(slot.sendBudget + (int64)((float)bytesPerSecond * deltaTime), (int64)maxBurst);
 	}
 }
 
+int64 Server::GetSendBudget(const ENetPeer* peer) const
+{
+	if (!IsConnected(peer))
+		return 0;
+
+	return peerSlots[SlotOf(peer)].sendBudget;
+}
+
+SnapshotHistory* Server::GetSnapshotHistory(ENetPeer* peer)
+{
+	if (!IsConnected(peer))
+		return nullptr;
+
+	return &peerSlots[SlotOf(peer)].snapshotHistory;
+}
+
+void Server::OnConnect(ENetPeer* peer)
+{
+	if (IsConnected(peer))
+		return;
+
+	PeerSlot& slot = peerSlots[SlotOf(peer)];
+	slot.peer = peer;
+	slot.connectedIndex = connectedPeers.size();
+	slot.sendBudget = 0;
+	slot.snapshotHistory = SnapshotHistory();
+	connectedPeers.push_back(peer);
+
+	onClientConnect(peer);
+}
+
 void Server::OnDisconnect(ENetPeer* peer)
 {
+	if (!IsConnected(peer))
+		return;
+
 	onClientDisconnect(peer);
-	connectedPeers.erase(peer);
+
+	// swap the last connected peer into the gap
+	PeerSlot& slot = peerSlots[SlotOf(peer)];
+	ENetPeer* last = connectedPeers.back();
+	connectedPeers[slot.connectedIndex] = last;
+	peerSlots[SlotOf(last)].connectedIndex = slot.connectedIndex;
+	connectedPeers.pop_back();
+
+	slot.peer = nullptr;
+	slot.snapshotHistory = SnapshotHistory();
 }
 
 
@@ -181,14 +585,17 @@ Client::Client() :
 {}
 
 Client::~Client()
-{}
+{
+	// while OnDisconnect can still be called for the events the thread left
+	StopNetworkThread();
+}
 
 bool Client::Initialize(ConnectionEvent _onServerConnect, ConnectionEvent _onServerDisconnect)
 {
 	onServerConnect = _onServerConnect;
 	onServerDisconnect = _onServerDisconnect;
 
-	host = enet_host_create(nullptr, 1, 2, 0, 0);
+	host = enet_host_create(nullptr, 1, (size_t)Channel::Count, 0, 0);
 
 	if (host == nullptr)
 	{
@@ -208,7 +615,14 @@ bool Client::RequestConnectionToServer(const char* serverIP, enet_uint16 port)
 	enet_address_set_host(&address, serverIP);
 	address.port = port;
 
-	server = enet_host_connect(host, &address, 2, 0);
+	// the network thread owns the host, take it back while connecting
+	bool threaded = IsThreaded();
+	StopNetworkThread();
+
+	server = enet_host_connect(host, &address, (size_t)Channel::Count, 0);
+
+	if (threaded)
+		StartNetworkThread();
 
 	if (server == nullptr)
 	{
@@ -1,24 +1,51 @@
 #pragma once
 #include "enet/enet.h"
+#include "snapshot.h"
+#include "core/ringbuffer.h"
+#include "core/spscring.h"
+#include "message.h"
+#include "netstats.h"
+#include "netsim.h"
 #include <vector>
 #include <memory>
-#include <unordered_set>
 #include <functional>
+#include <thread>
+#include <atomic>
 
 namespace Game
 {
 bool InitializeENet();
 
+// a received message, the packet is owned by the host and stays valid until ReleaseReceivedData
 struct Data
 {
 	ENetPeer* sender;
-	std::shared_ptr<std::vector<enet_uint8>> data;
+	ENetPacket* packet;
+	enet_uint8 channel;
 
 	Data();
-	Data(ENetPeer* _sender, enet_uint8* dataToCopy, size_t dataSize);
-	Data(const Data& other);
-	Data& operator=(const Data& other);
-	~Data();
+	Data(ENetPeer* _sender, ENetPacket* _packet, enet_uint8 _channel);
+
+	const enet_uint8* GetData() const;
+	size_t GetSize() const;
+};
+
+// what kind of traffic a message is, each kind has its own ENet channel so that
+// retransmissions of reliable messages never hold back the unreliable state stream
+enum class Channel : enet_uint8
+{
+	State,// unreliable and sequenced, a lost update is replaced by the next one
+	Events,// reliable and ordered gameplay events
+	Bulk,// reliable, large or unimportant messages such as chat
+	Count
+};
+
+// totals since the host was created
+struct SendCounters
+{
+	uint64 packets = 0;// messages queued with ENet, one per recipient
+	uint64 datagrams = 0;// UDP datagrams ENet actually sent, several packets can share one
+	uint64 bytes = 0;// UDP payload bytes
 };
 
 enum class HostType
@@ -30,8 +57,59 @@ enum class HostType
 class Host
 {
 protected:
+	struct QueuedData
+	{
+		Data data;
+		uint64 arrival;// increases with every received packet, to keep the order across channels
+	};
+
+	// what the network thread saw, handed to the game thread
+	struct NetworkEvent
+	{
+		ENetEventType type;
+		ENetPeer* peer;
+		ENetPacket* packet;
+		enet_uint8 channel;
+	};
+
+	// what the game thread wants done, handed to the network thread
+	struct NetworkCommand
+	{
+		enum Type
+		{
+			Send,
+			Broadcast,
+			Flush,
+			Release,// drop the sender's reference to a packet
+			BandwidthLimit
+		};
+
+		Type type;
+		ENetPeer* peer;
+		ENetPacket* packet;
+		Channel channel;
+		enet_uint32 incomingBandwidth = 0;// bytes per second, BandwidthLimit only
+		enet_uint32 outgoingBandwidth = 0;
+	};
+
 	ENetHost* host;
-	std::vector<Data> dataStack;
+	std::vector<Util::RingBuffer<QueuedData>> receiveQueues;// one per channel, oldest first
+	std::vector<ENetPacket*> receivedPackets;// every packet popped since the last release
+	uint64 nextArrival;
+	size_t receiveBatchSize;
+	size_t numPoppedSinceUpdate;
+	uint64 numPacketsSent;
+	std::atomic<uint64> numDatagramsSent;
+	std::atomic<uint64> numBytesSent;
+
+	// only used while the network thread runs, which then owns the ENet host
+	std::thread networkThread;
+	std::atomic<bool> networkThreadRunning;
+	Util::SpscRing<NetworkEvent> inboundEvents;
+	Util::SpscRing<NetworkCommand> outboundCommands;
+
+	NetStats stats;
+	NetSim netSim;// does nothing until a net_sim_ cvar is set
 
 public:
 	HostType type;
@@ -39,31 +117,92 @@ public:
 	Host(HostType _type);
 	virtual ~Host();
 
+	// services the host on a thread of its own, until stopped or destroyed.
+	// only call once the host is created and, for clients, connecting
+	bool StartNetworkThread();
+	void StopNetworkThread();
+	bool IsThreaded() const;
+
+	// handles connects, disconnects and received messages, on the calling thread
 	void Update();
-	bool PopDataStack(Data& outData);
-	void SendData(void* data, size_t byteSize, ENetPeer* peer, ENetPacketFlag packetFlag);
+	// sends everything queued with SendData/BroadcastData, call once at the end of the tick
+	void Flush();
+	// pops messages in the order they arrived, returns false when empty or when the batch size is reached
+	bool PopData(Data& outData);
+	// destroys the packets popped so far, call once all popped data has been handled
+	void ReleaseReceivedData();
+	// max messages popped per Update, the rest wait for the next one, 0 means no limit
+	void SetReceiveBatchSize(size_t maxMessages);
+	size_t GetQueueDepth() const;
+	size_t GetQueueDepth(enet_uint8 channel) const;
+	SendCounters GetSendCounters();
+	NetStats& GetStats();
+	// bytes per second, 0 for no limit. ENet throttles its peers to fit, and tells them what we accept
+	void SetBandwidthLimit(enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth);
+	void SendData(MessageBuilder& message, ENetPeer* peer, Channel channel);
 
 protected:
+	friend class MessageBuilder;
+
+	// moves ENet's 32 bit totals into the counters before they can overflow, on the thread that owns the host
+	void CollectHostCounters();
+	void HandleEvent(const NetworkEvent& event);
+	// services ENet and the network simulation, on the thread that owns the host
+	void ServiceHost(enet_uint32 timeout, const std::function<void(const NetworkEvent&)>& deliver);
+	// runs the command right away, or hands it to the network thread
+	void PostCommand(const NetworkCommand& command);
+	void ExecuteCommand(const NetworkCommand& command);
+	// called by MessageBuilder once it no longer needs its packet
+	void ReleasePacket(ENetPacket* packet);
+	void NetworkThreadLoop();
+	// stops the network thread and sends what it left, its received events stay queued
+	void JoinNetworkThread();
+
 	virtual void OnConnect(ENetPeer* peer) = 0;
 	virtual void OnDisconnect(ENetPeer* peer) = 0;
 };
 
 typedef std::function<void(ENetPeer*)> ConnectionEvent;
 
+// what the server keeps per connected peer
+struct PeerSlot
+{
+	ENetPeer* peer = nullptr;// nullptr while the slot is free
+	size_t connectedIndex = 0;// position in Server::connectedPeers
+	int64 sendBudget = 0;// bytes that may still be sent this tick, negative when overdrawn
+	SnapshotHistory snapshotHistory;
+};
+
 class Server : public Host
 {
 private:
 	ConnectionEvent onClientConnect;
 	ConnectionEvent onClientDisconnect;
+	std::vector<PeerSlot> peerSlots;// indexed by SlotOf
 
 public:
-	std::unordered_set<ENetPeer*> connectedPeers;
+	std::vector<ENetPeer*> connectedPeers;// dense, in no particular order
 
 	Server();
 	virtual ~Server() override;
 
-	bool Initialize(const char* serverIP, enet_uint16 port, ConnectionEvent _onClientConnect, ConnectionEvent _onClientDisconnect);
-	void BroadcastData(void* data, size_t byteSize, ENetPacketFlag packetFlag, ENetPeer* exlude = nullptr);
+	bool Initialize(const char* serverIP, enet_uint16 port, size_t maxPeers, ConnectionEvent _onClientConnect, ConnectionEvent _onClientDisconnect);
+	size_t GetMaxPeers() const;
+	// index in [0, GetMaxPeers()) that stays the same for as long as the peer is connected
+	static uint32 SlotOf(const ENetPeer* peer);
+	bool IsConnected(const ENetPeer* peer) const;
+	// nullptr if no peer is connected in the slot
+	ENetPeer* GetPeer(uint32 slot) const;
+	// same as Host::SendData, but charged to the peer's send budget
+	void SendData(MessageBuilder& message, ENetPeer* peer, Channel channel);
+	void BroadcastData(MessageBuilder& message, Channel channel, ENetPeer* exlude = nullptr);
+	// adds a tick's worth of bytes to every peer's budget, 0 bytes per second means no limit.
+	// unspent budget carries over, up to maxBurst bytes
+	void RefillSendBudgets(size_t bytesPerSecond, float deltaTime, size_t maxBurst);
+	// everything is sent anyway, but optional data should be left out once this reaches 0
+	int64 GetSendBudget(const ENetPeer* peer) const;
+	// nullptr if the peer is not connected
+	SnapshotHistory* GetSnapshotHistory(ENetPeer* peer);
 
 private:
 	virtual void OnConnect(ENetPeer* peer) override;
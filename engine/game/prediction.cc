@@ -0,0 +1,165 @@
+#include "config.h"
+#include "prediction.h"
+
+namespace Game
+{
+SpaceShipState SpaceShipState::Capture(const SpaceShip& spaceShip)
+{
+	return {
+		spaceShip.position,
+		spaceShip.orientation,
+		spaceShip.linearVelocity,
+		spaceShip.currentSpeed,
+		spaceShip.rotationZ,
+		spaceShip.rotXSmooth,
+		spaceShip.rotYSmooth,
+		spaceShip.rotZSmooth
+	};
+}
+
+void SpaceShipState::Apply(SpaceShip& spaceShip) const
+{
+	spaceShip.position = position;
+	spaceShip.orientation = orientation;
+	spaceShip.linearVelocity = linearVelocity;
+	spaceShip.currentSpeed = currentSpeed;
+	spaceShip.rotationZ = rotationZ;
+	spaceShip.rotXSmooth = rotXSmooth;
+	spaceShip.rotYSmooth = rotYSmooth;
+	spaceShip.rotZSmooth = rotZSmooth;
+	spaceShip.transform = glm::translate(position) * (glm::mat4)orientation;
+}
+
+InputQueue::InputQueue()
+{
+	Clear();
+}
+
+void InputQueue::Clear()
+{
+	first = 0;
+	count = 0;
+	newestSequence = 0;
+	processedSequence = 0;
+}
+
+void InputQueue::Push(uint32 sequence, const InputData& input)
+{
+	if (sequence <= newestSequence)
+		return;
+
+	if (count == capacity)
+	{
+		first = (first + 1) % capacity;
+		count--;
+	}
+
+	uint32 index = (first + count) % capacity;
+	inputs[index] = input;
+	sequences[index] = sequence;
+	count++;
+	newestSequence = sequence;
+}
+
+bool InputQueue::Pop(InputData& outInput)
+{
+	if (count == 0)
+		return false;
+
+	outInput = inputs[first];
+	processedSequence = sequences[first];
+	first = (first + 1) % capacity;
+	count--;
+	return true;
+}
+
+uint32 InputQueue::GetProcessedSequence() const
+{
+	return processedSequence;
+}
+
+ShipPredictor::ShipPredictor() :
+	nextSequence(1),
+	ackedSequence(0),
+	correction(0.f)
+{
+	for (Tick& tick : ticks)
+		tick.sequence = 0;
+}
+
+void ShipPredictor::Reset()
+{
+	// sequences keep counting, the server ignores any it has seen before
+	for (Tick& tick : ticks)
+		tick.sequence = 0;
+
+	ackedSequence = nextSequence - 1;
+	correction = glm::vec3(0.f);
+}
+
+uint32 ShipPredictor::Predict(SpaceShip& spaceShip, const InputData& input, float deltaTime)
+{
+	uint32 sequence = nextSequence++;
+
+	spaceShip.inputData = input;
+	spaceShip.ServerUpdate(deltaTime);
+	ticks[sequence % capacity] = { sequence, input, SpaceShipState::Capture(spaceShip) };
+	return sequence;
+}
+
+void ShipPredictor::Reconcile(SpaceShip& spaceShip, uint32 _ackedSequence, const glm::vec3& position, const glm::vec3& velocity, const glm::quat& orientation,
+	float deltaTime, float tolerance, float snapDistance)
+{
+	// snapshots arrive out of order, and inputs from before the last reset aren't ours to replay
+	if (_ackedSequence <= ackedSequence || _ackedSequence >= nextSequence)
+		return;
+
+	ackedSequence = _ackedSequence;
+	const Tick& acked = ticks[ackedSequence % capacity];
+	if (acked.sequence != ackedSequence)
+	{
+		// too far behind to replay, the server's state is the best there is
+		SpaceShipState state = SpaceShipState::Capture(spaceShip);
+		state.position = position;
+		state.linearVelocity = velocity;
+		state.orientation = orientation;
+		state.Apply(spaceShip);
+		Reset();
+		return;
+	}
+
+	glm::vec3 error = acked.state.position - position;
+	if (glm::dot(error, error) <= tolerance * tolerance && glm::abs(glm::dot(acked.state.orientation, orientation)) >= 0.9999f)
+		return;
+
+	// start over from the server's state with the smoothing the ship had then, and use the later inputs again
+	glm::vec3 predictedPosition = spaceShip.position;
+	SpaceShipState state = acked.state;
+	state.position = position;
+	state.linearVelocity = velocity;
+	state.orientation = orientation;
+	state.Apply(spaceShip);
+
+	for (uint32 sequence = ackedSequence + 1; sequence != nextSequence; sequence++)
+	{
+		Tick& tick = ticks[sequence % capacity];
+		if (tick.sequence != sequence)
+			continue;
+
+		spaceShip.inputData = tick.input;
+		spaceShip.ServerUpdate(deltaTime);
+		tick.state = SpaceShipState::Capture(spaceShip);
+	}
+
+	// keep drawing the ship where it was, and let Smooth move it over
+	correction += predictedPosition - spaceShip.position;
+	if (glm::dot(correction, correction) > snapDistance * snapDistance)
+		correction = glm::vec3(0.f);
+}
+
+void ShipPredictor::Smooth(SpaceShip& spaceShip, float deltaTime, float rate)
+{
+	correction *= glm::exp(-rate * deltaTime);
+	spaceShip.transform = glm::translate(spaceShip.position + correction) * (glm::mat4)spaceShip.orientation;
+}
+}
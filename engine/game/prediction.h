@@ -0,0 +1,81 @@
+#pragma once
+#include "spaceship.h"
+
+namespace Game
+{
+// everything SpaceShip::ServerUpdate carries over from one tick to the next
+struct SpaceShipState
+{
+	glm::vec3 position;
+	glm::quat orientation;
+	glm::vec3 linearVelocity;
+	float currentSpeed;
+	float rotationZ;
+	float rotXSmooth;
+	float rotYSmooth;
+	float rotZSmooth;
+
+	static SpaceShipState Capture(const SpaceShip& spaceShip);
+	void Apply(SpaceShip& spaceShip) const;
+};
+
+// inputs a client sent ahead of the server's ticks. the server uses one per tick, in the order the client
+// predicted them, so that the client can replay exactly what the server did
+class InputQueue
+{
+public:
+	static const uint32 capacity = 8;// more inputs than this waiting only adds latency, the oldest are dropped
+
+	InputQueue();
+
+	void Clear();
+	// inputs that arrive late or twice are ignored
+	void Push(uint32 sequence, const InputData& input);
+	// the input for the next tick, false if none arrived in time and the previous one should be used again
+	bool Pop(InputData& outInput);
+	// sequence of the last input used, echoed back to the client
+	uint32 GetProcessedSequence() const;
+
+private:
+	InputData inputs[capacity];
+	uint32 sequences[capacity];
+	uint32 first;
+	uint32 count;
+	uint32 newestSequence;
+	uint32 processedSequence;
+};
+
+// runs the controlled space ship ahead of the server on local input, and replays the inputs the server
+// hasn't used yet whenever its state for an older input arrives
+class ShipPredictor
+{
+public:
+	static const uint32 capacity = 128;// unacknowledged ticks kept, two seconds at 60 ticks per second
+
+	ShipPredictor();
+
+	// forgets every prediction, the ship's current state becomes the starting point
+	void Reset();
+	// one tick on a sampled input, returns the sequence the input is sent with
+	uint32 Predict(SpaceShip& spaceShip, const InputData& input, float deltaTime);
+	// the server's state right after it used the input with ackedSequence. corrections within tolerance are
+	// quantization and ignored, ones beyond snapDistance are shown right away instead of eased out
+	void Reconcile(SpaceShip& spaceShip, uint32 ackedSequence, const glm::vec3& position, const glm::vec3& velocity, const glm::quat& orientation,
+		float deltaTime, float tolerance, float snapDistance);
+	// eases out what is left of corrections at rate per second, and places the ship where it is drawn
+	void Smooth(SpaceShip& spaceShip, float deltaTime, float rate);
+
+private:
+	struct Tick
+	{
+		uint32 sequence;
+		InputData input;
+		SpaceShipState state;// after the input was used
+	};
+
+	Tick ticks[capacity];// indexed by sequence
+	uint32 nextSequence;// starts at 1, the server takes 0 as an input without a sequence
+	uint32 ackedSequence;
+	glm::vec3 correction;// drawn offset from the predicted position
+};
+}
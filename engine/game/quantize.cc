@@ -0,0 +1,124 @@
+#include "config.h"
+#include "quantize.h"
+#include <algorithm>
+
+namespace Game
+{
+// maps [-bound, bound] onto a symmetric range of signed steps so that 0 survives the round trip exactly
+static int32 QuantizeSigned(float value, float bound, uint32 bits)
+{
+	const int32 maxSteps = (1 << (bits - 1)) - 1;
+	float normalized = std::clamp(value / bound, -1.f, 1.f);
+	return (int32)glm::round(normalized * (float)maxSteps);
+}
+
+static float DequantizeSigned(int32 steps, float bound, uint32 bits)
+{
+	const int32 maxSteps = (1 << (bits - 1)) - 1;
+	return (float)steps / (float)maxSteps * bound;
+}
+
+// the same as above, but offset into an unsigned bit field
+static uint32 QuantizeField(float value, float bound, uint32 bits)
+{
+	const int32 maxSteps = (1 << (bits - 1)) - 1;
+	return (uint32)(QuantizeSigned(value, bound, bits) + maxSteps);
+}
+
+static float DequantizeField(uint32 field, float bound, uint32 bits)
+{
+	const int32 maxSteps = (1 << (bits - 1)) - 1;
+	return DequantizeSigned((int32)field - maxSteps, bound, bits);
+}
+
+
+// --- position ---
+
+glm::i16vec3 QuantizePosition(const glm::vec3& position, float worldBound)
+{
+	return glm::i16vec3(
+		(int16)QuantizeSigned(position.x, worldBound, 16),
+		(int16)QuantizeSigned(position.y, worldBound, 16),
+		(int16)QuantizeSigned(position.z, worldBound, 16)
+	);
+}
+
+glm::vec3 DequantizePosition(const glm::i16vec3& quantized, float worldBound)
+{
+	return glm::vec3(
+		DequantizeSigned(quantized.x, worldBound, 16),
+		DequantizeSigned(quantized.y, worldBound, 16),
+		DequantizeSigned(quantized.z, worldBound, 16)
+	);
+}
+
+
+// --- velocity ---
+
+uint32 QuantizeVelocity(const glm::vec3& velocity, float maxSpeed)
+{
+	return (QuantizeField(velocity.x, maxSpeed, 11) << 21) |
+		(QuantizeField(velocity.y, maxSpeed, 11) << 10) |
+		QuantizeField(velocity.z, maxSpeed, 10);
+}
+
+glm::vec3 DequantizeVelocity(uint32 quantized, float maxSpeed)
+{
+	return glm::vec3(
+		DequantizeField((quantized >> 21) & 0x7ff, maxSpeed, 11),
+		DequantizeField((quantized >> 10) & 0x7ff, maxSpeed, 11),
+		DequantizeField(quantized & 0x3ff, maxSpeed, 10)
+	);
+}
+
+
+// --- orientation ---
+
+// every component except the largest lies within [-1/sqrt(2), 1/sqrt(2)]
+static const float smallestThreeBound = 0.70710678f;
+
+uint32 QuantizeOrientation(const glm::quat& orientation)
+{
+	glm::quat q = glm::normalize(orientation);
+	float components[4] = { q.x, q.y, q.z, q.w };
+
+	uint32 largest = 0;
+	for (uint32 i = 1; i < 4; i++)
+	{
+		if (glm::abs(components[i]) > glm::abs(components[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation, flip it so that the dropped component is positive
+	float sign = components[largest] < 0.f ? -1.f : 1.f;
+
+	uint32 quantized = largest;
+	for (uint32 i = 0; i < 4; i++)
+	{
+		if (i != largest)
+			quantized = (quantized << 10) | QuantizeField(components[i] * sign, smallestThreeBound, 10);
+	}
+
+	return quantized;
+}
+
+glm::quat DequantizeOrientation(uint32 quantized)
+{
+	uint32 largest = quantized >> 30;
+	float components[4];
+	float sumSquares = 0.f;
+
+	for (int i = 3, shift = 0; i >= 0; i--)
+	{
+		if ((uint32)i == largest)
+			continue;
+
+		components[i] = DequantizeField((quantized >> shift) & 0x3ff, smallestThreeBound, 10);
+		sumSquares += components[i] * components[i];
+		shift += 10;
+	}
+
+	components[largest] = glm::sqrt(std::max(0.f, 1.f - sumSquares));
+	return glm::normalize(glm::quat(components[3], components[0], components[1], components[2]));
+}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "glm.hpp"
+
+namespace Game
+{
+// ranges the quantized values must fit in, the server decides them and sends them to the clients
+struct QuantizationBounds
+{
+	float worldBound = 1024.f;// positions are clamped to [-worldBound, worldBound] on every axis
+	float maxSpeed = 4.f;// velocities are clamped to [-maxSpeed, maxSpeed] on every axis
+};
+
+// 16 bit fixed point per axis
+glm::i16vec3 QuantizePosition(const glm::vec3& position, float worldBound);
+glm::vec3 DequantizePosition(const glm::i16vec3& quantized, float worldBound);
+
+// 11/11/10 bits for x/y/z packed into one word
+uint32 QuantizeVelocity(const glm::vec3& velocity, float maxSpeed);
+glm::vec3 DequantizeVelocity(uint32 quantized, float maxSpeed);
+
+// smallest three: 2 bits for the index of the largest component, 10 bits for each of the other three
+uint32 QuantizeOrientation(const glm::quat& orientation);
+glm::quat DequantizeOrientation(uint32 quantized);
+}
@@ -0,0 +1,258 @@
+#include "config.h"
+#include "shipintegrate.h"
+#include "spaceship.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SHIP_LANES 8
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SHIP_LANES 4
+#else
+#define SHIP_LANES 1
+#endif
+
+namespace Game
+{
+void IntegrateShipsScalar(ShipStore& ships, float deltaTime)
+{
+	size_t count = ships.Size();
+	for (size_t i = 0; i < count; i++)
+	{
+		IntegrateShip(ships.inputs[i], deltaTime, ships.positions[i], ships.orientations[i], ships.velocities[i],
+			ships.speeds[i], ships.turnRates[i], ships.rolls[i]);
+	}
+}
+
+#if SHIP_LANES > 1
+namespace
+{
+#if SHIP_LANES == 8
+typedef __m256 Wide;
+inline Wide Set(float f) { return _mm256_set1_ps(f); }
+inline Wide Load(const float* p) { return _mm256_load_ps(p); }
+inline void Store(float* p, Wide a) { _mm256_store_ps(p, a); }
+inline Wide Add(Wide a, Wide b) { return _mm256_add_ps(a, b); }
+inline Wide Sub(Wide a, Wide b) { return _mm256_sub_ps(a, b); }
+inline Wide Mul(Wide a, Wide b) { return _mm256_mul_ps(a, b); }
+inline Wide Min(Wide a, Wide b) { return _mm256_min_ps(a, b); }
+inline Wide Max(Wide a, Wide b) { return _mm256_max_ps(a, b); }
+#else
+typedef __m128 Wide;
+inline Wide Set(float f) { return _mm_set1_ps(f); }
+inline Wide Load(const float* p) { return _mm_load_ps(p); }
+inline void Store(float* p, Wide a) { _mm_store_ps(p, a); }
+inline Wide Add(Wide a, Wide b) { return _mm_add_ps(a, b); }
+inline Wide Sub(Wide a, Wide b) { return _mm_sub_ps(a, b); }
+inline Wide Mul(Wide a, Wide b) { return _mm_mul_ps(a, b); }
+inline Wide Min(Wide a, Wide b) { return _mm_min_ps(a, b); }
+inline Wide Max(Wide a, Wide b) { return _mm_max_ps(a, b); }
+#endif
+
+// taylor series, within a few ulp for |x| <= pi/2. IntegrateShips only passes half of a tick's turn, far less
+inline void SinCos(Wide x, Wide& outSin, Wide& outCos)
+{
+	Wide x2 = Mul(x, x);
+	Wide s = Set(-1.f / 39916800.f);
+	s = Add(Mul(s, x2), Set(1.f / 362880.f));
+	s = Add(Mul(s, x2), Set(-1.f / 5040.f));
+	s = Add(Mul(s, x2), Set(1.f / 120.f));
+	s = Add(Mul(s, x2), Set(-1.f / 6.f));
+	s = Add(Mul(s, x2), Set(1.f));
+	outSin = Mul(s, x);
+
+	Wide c = Set(1.f / 479001600.f);
+	c = Add(Mul(c, x2), Set(-1.f / 3628800.f));
+	c = Add(Mul(c, x2), Set(1.f / 40320.f));
+	c = Add(Mul(c, x2), Set(-1.f / 720.f));
+	c = Add(Mul(c, x2), Set(1.f / 24.f));
+	c = Add(Mul(c, x2), Set(-1.f / 2.f));
+	outCos = Add(Mul(c, x2), Set(1.f));
+}
+
+// the store keeps vec3s and quats, a block of ships is turned into one array per component and back
+enum Lane
+{
+	Lane_PositionX, Lane_PositionY, Lane_PositionZ,
+	Lane_OrientationX, Lane_OrientationY, Lane_OrientationZ, Lane_OrientationW,
+	Lane_VelocityX, Lane_VelocityY, Lane_VelocityZ,
+	Lane_Speed, Lane_SpeedTarget, Lane_SpeedRate, Lane_Throttle,
+	Lane_TurnX, Lane_TurnY, Lane_TurnZ,
+	Lane_TurnTargetX, Lane_TurnTargetY, Lane_TurnTargetZ,
+	Lane_Roll,
+	Lane_Count
+};
+
+struct Block
+{
+	alignas(32) float lanes[Lane_Count][SHIP_LANES];
+};
+
+// the same operations in the same order as IntegrateShip, so that only sin and cos round differently
+void IntegrateBlock(Block& block, float deltaTime)
+{
+	float (*b)[SHIP_LANES] = block.lanes;
+	const Wide zero = Set(0.f);
+	const Wide one = Set(1.f);
+	const Wide two = Set(2.f);
+	const Wide half = Set(0.5f);
+
+	// speed towards the throttle's target, or stopped
+	Wide speed = Load(b[Lane_Speed]);
+	Wide speedRate = Load(b[Lane_SpeedRate]);
+	speed = Add(Mul(speed, Sub(one, speedRate)), Mul(Load(b[Lane_SpeedTarget]), speedRate));
+	speed = Mul(speed, Load(b[Lane_Throttle]));
+	Store(b[Lane_Speed], speed);
+
+	// orientation * vec3(0, 0, speed), glm's quat-vector product with the zero terms left out
+	Wide qx = Load(b[Lane_OrientationX]);
+	Wide qy = Load(b[Lane_OrientationY]);
+	Wide qz = Load(b[Lane_OrientationZ]);
+	Wide qw = Load(b[Lane_OrientationW]);
+	Wide uvx = Mul(qy, speed);
+	Wide uvy = Sub(zero, Mul(qx, speed));
+	Wide uuvx = Sub(zero, Mul(qz, uvy));
+	Wide uuvy = Mul(qz, uvx);
+	Wide uuvz = Sub(Mul(qx, uvy), Mul(qy, uvx));
+	Wide desiredX = Mul(Add(Mul(uvx, qw), uuvx), two);
+	Wide desiredY = Mul(Add(Mul(uvy, qw), uuvy), two);
+	Wide desiredZ = Add(speed, Mul(Add(Mul(zero, qw), uuvz), two));
+
+	const Wide acceleration = Set(deltaTime * SpaceShip::accelerationFactor);
+	const Wide keep = Sub(one, acceleration);
+	Wide vx = Add(Mul(Load(b[Lane_VelocityX]), keep), Mul(desiredX, acceleration));
+	Wide vy = Add(Mul(Load(b[Lane_VelocityY]), keep), Mul(desiredY, acceleration));
+	Wide vz = Add(Mul(Load(b[Lane_VelocityZ]), keep), Mul(desiredZ, acceleration));
+	Store(b[Lane_VelocityX], vx);
+	Store(b[Lane_VelocityY], vy);
+	Store(b[Lane_VelocityZ], vz);
+
+	const Wide dt = Set(deltaTime);
+	const Wide velocityScale = Set(SpaceShip::velocityScale);
+	Store(b[Lane_PositionX], Add(Load(b[Lane_PositionX]), Mul(Mul(vx, dt), velocityScale)));
+	Store(b[Lane_PositionY], Add(Load(b[Lane_PositionY]), Mul(Mul(vy, dt), velocityScale)));
+	Store(b[Lane_PositionZ], Add(Load(b[Lane_PositionZ]), Mul(Mul(vz, dt), velocityScale)));
+
+	// smoothed turn rates
+	const Wide rotationSpeed = Set(1.8f * deltaTime);
+	const Wide smooth = Set(SpaceShip::cameraSmoothFactor * (1.f / 60.f));
+	const Wide smoothKeep = Sub(one, smooth);
+	Wide tx = Add(Mul(Load(b[Lane_TurnX]), smoothKeep), Mul(Mul(Load(b[Lane_TurnTargetX]), rotationSpeed), smooth));
+	Wide ty = Add(Mul(Load(b[Lane_TurnY]), smoothKeep), Mul(Mul(Load(b[Lane_TurnTargetY]), rotationSpeed), smooth));
+	Wide tz = Add(Mul(Load(b[Lane_TurnZ]), smoothKeep), Mul(Mul(Load(b[Lane_TurnTargetZ]), rotationSpeed), smooth));
+	Store(b[Lane_TurnX], tx);
+	Store(b[Lane_TurnY], ty);
+	Store(b[Lane_TurnZ], tz);
+
+	// quat(vec3(-ty, tx, tz)) from euler angles, as glm builds it
+	Wide sx, cx, sy, cy, sz, cz;
+	SinCos(Mul(Sub(zero, ty), half), sx, cx);
+	SinCos(Mul(tx, half), sy, cy);
+	SinCos(Mul(tz, half), sz, cz);
+	Wide lw = Add(Mul(Mul(cx, cy), cz), Mul(Mul(sx, sy), sz));
+	Wide lx = Sub(Mul(Mul(sx, cy), cz), Mul(Mul(cx, sy), sz));
+	Wide ly = Add(Mul(Mul(cx, sy), cz), Mul(Mul(sx, cy), sz));
+	Wide lz = Sub(Mul(Mul(cx, cy), sz), Mul(Mul(sx, sy), cz));
+
+	// orientation * local
+	Store(b[Lane_OrientationW], Sub(Sub(Sub(Mul(qw, lw), Mul(qx, lx)), Mul(qy, ly)), Mul(qz, lz)));
+	Store(b[Lane_OrientationX], Sub(Add(Add(Mul(qw, lx), Mul(qx, lw)), Mul(qy, lz)), Mul(qz, ly)));
+	Store(b[Lane_OrientationY], Sub(Add(Add(Mul(qw, ly), Mul(qy, lw)), Mul(qz, lx)), Mul(qx, lz)));
+	Store(b[Lane_OrientationZ], Sub(Add(Add(Mul(qw, lz), Mul(qz, lw)), Mul(qx, ly)), Mul(qy, lx)));
+
+	// roll leans into turns and settles back
+	Wide roll = Sub(Load(b[Lane_Roll]), tx);
+	roll = Min(Max(roll, Set(-45.f)), Set(45.f));
+	Store(b[Lane_Roll], Mul(roll, smoothKeep));
+}
+}
+#endif
+
+void IntegrateShips(ShipStore& ships, float deltaTime)
+{
+#if SHIP_LANES > 1
+	// half of a turn rate goes into sin and cos, beyond pi the polynomial is off and the ship goes the slow way
+	const float maxTurn = 3.14159265f;
+	const float boostRate = std::min(1.0f, deltaTime * 30.0f);
+	const float normalRate = std::min(1.0f, deltaTime * 90.0f);
+	bool turnInRange = 1.8f * deltaTime <= maxTurn;
+
+	// turn rates and roll of ships flying straight decay towards zero and spend most of their time as
+	// denormals, which cost many times a normal multiply. flushed here, a difference far below what is sent
+	unsigned int csr = _mm_getcsr();
+	_mm_setcsr(csr | 0x8040);// flush to zero, denormals are zero
+
+	Block block;
+	float (*b)[SHIP_LANES] = block.lanes;
+	size_t count = ships.Size();
+	size_t i = 0;
+	for (; i + SHIP_LANES <= count; i += SHIP_LANES)
+	{
+		bool inRange = turnInRange;
+		for (size_t l = 0; l < SHIP_LANES; l++)
+		{
+			size_t s = i + l;
+			uint16 input = ships.inputs[s];
+			const glm::vec3& turn = ships.turnRates[s];
+			inRange = inRange && glm::abs(turn.x) <= maxTurn && glm::abs(turn.y) <= maxTurn && glm::abs(turn.z) <= maxTurn;
+
+			b[Lane_PositionX][l] = ships.positions[s].x;
+			b[Lane_PositionY][l] = ships.positions[s].y;
+			b[Lane_PositionZ][l] = ships.positions[s].z;
+			b[Lane_OrientationX][l] = ships.orientations[s].x;
+			b[Lane_OrientationY][l] = ships.orientations[s].y;
+			b[Lane_OrientationZ][l] = ships.orientations[s].z;
+			b[Lane_OrientationW][l] = ships.orientations[s].w;
+			b[Lane_VelocityX][l] = ships.velocities[s].x;
+			b[Lane_VelocityY][l] = ships.velocities[s].y;
+			b[Lane_VelocityZ][l] = ships.velocities[s].z;
+			b[Lane_Speed][l] = ships.speeds[s];
+			b[Lane_SpeedTarget][l] = (input & InputBit_Shift) ? SpaceShip::boostSpeed : SpaceShip::normalSpeed;
+			b[Lane_SpeedRate][l] = (input & InputBit_Shift) ? boostRate : normalRate;
+			b[Lane_Throttle][l] = (input & InputBit_W) ? 1.f : 0.f;
+			b[Lane_TurnX][l] = turn.x;
+			b[Lane_TurnY][l] = turn.y;
+			b[Lane_TurnZ][l] = turn.z;
+			b[Lane_TurnTargetX][l] = (input & InputBit_Left) ? 1.0f : (input & InputBit_Right) ? -1.0f : 0.0f;
+			b[Lane_TurnTargetY][l] = (input & InputBit_Up) ? -1.0f : (input & InputBit_Down) ? 1.0f : 0.0f;
+			b[Lane_TurnTargetZ][l] = (input & InputBit_A) ? -1.0f : (input & InputBit_D) ? 1.0f : 0.0f;
+			b[Lane_Roll][l] = ships.rolls[s];
+		}
+
+		if (!inRange)
+		{
+			for (size_t s = i; s < i + SHIP_LANES; s++)
+			{
+				IntegrateShip(ships.inputs[s], deltaTime, ships.positions[s], ships.orientations[s], ships.velocities[s],
+					ships.speeds[s], ships.turnRates[s], ships.rolls[s]);
+			}
+			continue;
+		}
+
+		IntegrateBlock(block, deltaTime);
+
+		for (size_t l = 0; l < SHIP_LANES; l++)
+		{
+			size_t s = i + l;
+			ships.positions[s] = glm::vec3(b[Lane_PositionX][l], b[Lane_PositionY][l], b[Lane_PositionZ][l]);
+			ships.orientations[s] = glm::quat(b[Lane_OrientationW][l], b[Lane_OrientationX][l], b[Lane_OrientationY][l], b[Lane_OrientationZ][l]);
+			ships.velocities[s] = glm::vec3(b[Lane_VelocityX][l], b[Lane_VelocityY][l], b[Lane_VelocityZ][l]);
+			ships.speeds[s] = b[Lane_Speed][l];
+			ships.turnRates[s] = glm::vec3(b[Lane_TurnX][l], b[Lane_TurnY][l], b[Lane_TurnZ][l]);
+			ships.rolls[s] = b[Lane_Roll][l];
+		}
+	}
+
+	// the ships that don't fill a block
+	for (; i < count; i++)
+	{
+		IntegrateShip(ships.inputs[i], deltaTime, ships.positions[i], ships.orientations[i], ships.velocities[i],
+			ships.speeds[i], ships.turnRates[i], ships.rolls[i]);
+	}
+
+	_mm_setcsr(csr);
+#else
+	IntegrateShipsScalar(ships, deltaTime);
+#endif
+}
+}
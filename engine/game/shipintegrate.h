@@ -0,0 +1,15 @@
+#pragma once
+#include "shipstore.h"
+
+namespace Game
+{
+// most a ship moved by IntegrateShips may differ from IntegrateShip after one tick, in units and in quaternion
+// components. the wide path uses polynomial sin and cos and flushes denormals to zero, the scalar one doesn't
+static constexpr float shipIntegrateTolerance = 1e-5f;
+
+// moves every ship in the store one tick on its input, what IntegrateShip does for one ship. eight ships at a
+// time when built for AVX2 (GAME_AVX2 in cmake), four with SSE. within shipIntegrateTolerance of the scalar path
+void IntegrateShips(ShipStore& ships, float deltaTime);
+// one ship at a time through IntegrateShip, the fallback on other targets and the reference for the above
+void IntegrateShipsScalar(ShipStore& ships, float deltaTime);
+}
@@ -0,0 +1,98 @@
+#include "config.h"
+#include "shipstore.h"
+
+namespace Game
+{
+ShipHandle ShipStore::Add(uint32 id, uint32 owner, const glm::vec3& position, const glm::quat& orientation)
+{
+	SlotId slot;
+	if (slots.Allocate(slot))
+		denseIndices.push_back(0);
+
+	ShipHandle handle = ((uint32)slot.generation << slotBits) | slot.index;
+	denseIndices[slot.index] = (uint32)handles.size();
+
+	handles.push_back(handle);
+	ids.push_back(id);
+	owners.push_back(owner);
+	positions.push_back(position);
+	orientations.push_back(orientation);
+	velocities.push_back(glm::vec3(0.f));
+	speeds.push_back(0.f);
+	turnRates.push_back(glm::vec3(0.f));
+	rolls.push_back(0.f);
+	inputs.push_back(0);
+	inputTimes.push_back(0);
+	laserTimers.push_back(0.f);
+	hits.push_back(0);
+	return handle;
+}
+
+void ShipStore::Remove(ShipHandle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	uint32 slot = handle & ((1 << slotBits) - 1);
+	uint32 index = denseIndices[slot];
+	uint32 last = (uint32)handles.size() - 1;
+
+	// the last ship takes the removed one's place
+	if (index != last)
+	{
+		handles[index] = handles[last];
+		ids[index] = ids[last];
+		owners[index] = owners[last];
+		positions[index] = positions[last];
+		orientations[index] = orientations[last];
+		velocities[index] = velocities[last];
+		speeds[index] = speeds[last];
+		turnRates[index] = turnRates[last];
+		rolls[index] = rolls[last];
+		inputs[index] = inputs[last];
+		inputTimes[index] = inputTimes[last];
+		laserTimers[index] = laserTimers[last];
+		hits[index] = hits[last];
+		denseIndices[handles[index] & ((1 << slotBits) - 1)] = index;
+	}
+
+	handles.pop_back();
+	ids.pop_back();
+	owners.pop_back();
+	positions.pop_back();
+	orientations.pop_back();
+	velocities.pop_back();
+	speeds.pop_back();
+	turnRates.pop_back();
+	rolls.pop_back();
+	inputs.pop_back();
+	inputTimes.pop_back();
+	laserTimers.pop_back();
+	hits.pop_back();
+
+	slots.Deallocate({ slot, slots.generations[slot] });
+}
+
+void ShipStore::Clear()
+{
+	while (!handles.empty())
+		Remove(handles.back());
+}
+
+bool ShipStore::IsValid(ShipHandle handle) const
+{
+	uint32 slot = handle & ((1 << slotBits) - 1);
+	return slot < slots.generations.size() && (handle >> slotBits) == (slots.generations[slot] & (0xFFFFFFFF >> slotBits)) &&
+		denseIndices[slot] < handles.size() && handles[denseIndices[slot]] == handle;
+}
+
+uint32 ShipStore::IndexOf(ShipHandle handle) const
+{
+	return denseIndices[handle & ((1 << slotBits) - 1)];
+}
+
+size_t ShipStore::Size() const
+{
+	return handles.size();
+}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "core/idpool.h"
+#include <vector>
+
+namespace Game
+{
+// names a ship in a ShipStore for as long as it exists, whatever happens to the ships around it
+typedef uint32 ShipHandle;
+static const ShipHandle invalidShipHandle = 0xFFFFFFFF;
+
+// the server's space ships, one array per field so that a tick streams through each array it needs and nothing
+// else. ships are kept dense, removing one moves the last ship into its place
+class ShipStore
+{
+public:
+	ShipHandle Add(uint32 id, uint32 owner, const glm::vec3& position, const glm::quat& orientation);
+	void Remove(ShipHandle handle);
+	void Clear();
+	bool IsValid(ShipHandle handle) const;
+	// index into the arrays below, changes whenever a ship is removed
+	uint32 IndexOf(ShipHandle handle) const;
+	size_t Size() const;
+
+	std::vector<ShipHandle> handles;
+	std::vector<uint32> ids;
+	std::vector<uint32> owners;// whatever the ship belongs to, the server's peer slot
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> orientations;
+	std::vector<glm::vec3> velocities;
+	std::vector<float> speeds;
+	std::vector<glm::vec3> turnRates;// smoothed x/y/z rotation, see IntegrateShip
+	std::vector<float> rolls;
+	std::vector<uint16> inputs;// InputBit mask
+	std::vector<uint64> inputTimes;// client time of the input, newer ones replace older
+	std::vector<float> laserTimers;// seconds since the last laser
+	std::vector<uint8> hits;// hit by a laser or another ship this tick
+
+private:
+	// handle = generation << 22 | slot like the engine's other ids, the generation tells a removed ship's handle
+	// from the next one in its slot
+	static const uint32 slotBits = 22;
+	struct SlotId
+	{
+		uint32 index;
+		uint16 generation;// the pool's whole generation, only the low bits fit in a handle
+	};
+
+	Util::IdPool<SlotId> slots;// reuses a slot only after many others were freed
+	std::vector<uint32> denseIndices;// indexed by handle slot
+};
+
+}
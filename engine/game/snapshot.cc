@@ -0,0 +1,152 @@
+#include "config.h"
+#include "snapshot.h"
+#include <algorithm>
+
+namespace Game
+{
+const EntityState* Snapshot::Find(uint32 id) const
+{
+	auto it = std::lower_bound(entities.begin(), entities.end(), id,
+		[](const EntityState& state, uint32 id) { return state.id < id; });
+
+	if (it == entities.end() || it->id != id)
+		return nullptr;
+
+	return &*it;
+}
+
+EntityState& Snapshot::FindOrAdd(uint32 id)
+{
+	auto it = std::lower_bound(entities.begin(), entities.end(), id,
+		[](const EntityState& state, uint32 id) { return state.id < id; });
+
+	if (it == entities.end() || it->id != id)
+		it = entities.insert(it, { id, glm::i16vec3(0), QuantizeVelocity(glm::vec3(0.f), 1.f), QuantizeOrientation(glm::identity<glm::quat>()) });
+
+	return *it;
+}
+
+bool Snapshot::Remove(uint32 id)
+{
+	auto it = std::lower_bound(entities.begin(), entities.end(), id,
+		[](const EntityState& state, uint32 id) { return state.id < id; });
+
+	if (it == entities.end() || it->id != id)
+		return false;
+
+	entities.erase(it);
+	return true;
+}
+
+uint8 DiffEntity(const EntityState* baseline, const EntityState& current)
+{
+	if (baseline == nullptr)
+		return EntityField_All;
+
+	uint8 changedFields = 0;
+	if (baseline->position != current.position)
+		changedFields |= EntityField_Position;
+	if (baseline->velocity != current.velocity)
+		changedFields |= EntityField_Velocity;
+	if (baseline->orientation != current.orientation)
+		changedFields |= EntityField_Orientation;
+
+	return changedFields;
+}
+
+void DiffSnapshots(const Snapshot* baseline, const Snapshot& current, std::vector<EntityDelta>& outDeltas)
+{
+	size_t b = 0;
+	size_t numBaseline = baseline != nullptr ? baseline->entities.size() : 0;
+
+	// both entity lists are sorted by id, so walk them side by side
+	for (const EntityState& state : current.entities)
+	{
+		while (b < numBaseline && baseline->entities[b].id < state.id)
+			b++;
+
+		if (b >= numBaseline || baseline->entities[b].id != state.id)
+		{
+			outDeltas.push_back({ &state, EntityField_All });
+			continue;
+		}
+
+		uint8 changedFields = DiffEntity(&baseline->entities[b], state);
+		if (changedFields != 0)
+			outDeltas.push_back({ &state, changedFields });
+	}
+}
+
+void DiffRemoved(const Snapshot* baseline, const Snapshot& current, std::vector<uint32>& outRemoved)
+{
+	if (baseline == nullptr)
+		return;
+
+	size_t c = 0;
+	for (const EntityState& state : baseline->entities)
+	{
+		while (c < current.entities.size() && current.entities[c].id < state.id)
+			c++;
+
+		if (c >= current.entities.size() || current.entities[c].id != state.id)
+			outRemoved.push_back(state.id);
+	}
+}
+
+
+// --- snapshot ring ---
+
+void SnapshotRing::Store(const SnapshotPtr& snapshot)
+{
+	snapshots[snapshot->sequence % capacity] = snapshot;
+}
+
+SnapshotPtr SnapshotRing::Find(uint32 sequence) const
+{
+	const SnapshotPtr& snapshot = snapshots[sequence % capacity];
+	if (sequence == 0 || snapshot == nullptr || snapshot->sequence != sequence)
+		return nullptr;
+
+	return snapshot;
+}
+
+void SnapshotRing::Evict(uint32 id)
+{
+	for (uint32 i = 0; i < capacity; i++)
+	{
+		if (snapshots[i] == nullptr || snapshots[i]->Find(id) == nullptr)
+			continue;
+
+		// stored snapshots are shared and immutable, replace the one holding the entity with a copy without it
+		auto copy = std::make_shared<Snapshot>(*snapshots[i]);
+		copy->Remove(id);
+		snapshots[i] = copy;
+	}
+}
+
+void SnapshotRing::Clear()
+{
+	for (uint32 i = 0; i < capacity; i++)
+		snapshots[i] = nullptr;
+}
+
+
+// --- snapshot history ---
+
+void SnapshotHistory::Ack(uint32 sequence)
+{
+	if (sequence == 0)
+	{
+		baseline = nullptr;
+		return;
+	}
+
+	// acks arrive unreliably and out of order, only ever move forward
+	if (baseline != nullptr && sequence <= baseline->sequence)
+		return;
+
+	SnapshotPtr snapshot = sent.Find(sequence);
+	if (snapshot != nullptr)
+		baseline = snapshot;
+}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "quantize.h"
+#include <vector>
+#include <memory>
+
+namespace Game
+{
+// kept in its quantized wire form, so that diffs only see changes that survive quantization
+struct EntityState
+{
+	uint32 id;
+	glm::i16vec3 position;
+	uint32 velocity;
+	uint32 orientation;
+};
+
+// the state of all networked entities at one point in time, entities sorted by id
+struct Snapshot
+{
+	uint32 sequence = 0;// 0 is never sent and means "no snapshot"
+	uint64 time = 0;
+	std::vector<EntityState> entities;
+
+	const EntityState* Find(uint32 id) const;
+	// inserts a zeroed entity at its sorted position if the id is missing
+	EntityState& FindOrAdd(uint32 id);
+	// false if the id wasn't there
+	bool Remove(uint32 id);
+};
+
+typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
+enum EntityField : uint8
+{
+	EntityField_Position = 1 << 0,
+	EntityField_Velocity = 1 << 1,
+	EntityField_Orientation = 1 << 2,
+	EntityField_All = EntityField_Position | EntityField_Velocity | EntityField_Orientation
+};
+
+struct EntityDelta
+{
+	const EntityState* state;
+	uint8 changedFields;// EntityField bits
+};
+
+// EntityField bits that differ, everything if there is no baseline
+uint8 DiffEntity(const EntityState* baseline, const EntityState& current);
+// appends every entity of current that differs from baseline, baseline may be nullptr
+void DiffSnapshots(const Snapshot* baseline, const Snapshot& current, std::vector<EntityDelta>& outDeltas);
+// appends the id of every entity of baseline that current no longer has, a delta can't express that on its own
+void DiffRemoved(const Snapshot* baseline, const Snapshot& current, std::vector<uint32>& outRemoved);
+
+// the last few snapshots, indexed by sequence number
+class SnapshotRing
+{
+public:
+	static const uint32 capacity = 32;
+
+	void Store(const SnapshotPtr& snapshot);
+	// nullptr if the snapshot was never stored or has been overwritten
+	SnapshotPtr Find(uint32 sequence) const;
+	// drops the entity from every stored snapshot, so that no later delta is rebuilt on top of it
+	void Evict(uint32 id);
+	void Clear();
+
+private:
+	SnapshotPtr snapshots[capacity];
+};
+
+// what has been sent to one peer, and which of it the peer has confirmed
+struct SnapshotHistory
+{
+	SnapshotRing sent;
+	SnapshotPtr baseline;// newest acknowledged snapshot, nullptr if none
+
+	// sequence 0 means the peer lost its baseline and needs full snapshots again
+	void Ack(uint32 sequence);
+};
+}
@@ -1,19 +1,25 @@
 #include "config.h"
 #include "spaceship.h"
-#include "render/input/inputserver.h"
-#include "render/cameramanager.h"
 #include "render/physics.h"
-#include "render/debugrender.h"
-#include "render/particlesystem.h"
 #include <vector>
 
-using namespace Input;
 using namespace glm;
-using namespace Render;
 
 namespace Game
 {
 
+// ends of the rays that make up the hull, from the center of the ship
+static const glm::vec3 colliderEndPoints[8] = {
+    glm::vec3(-1.10657, -0.480347, -0.346542),  // right wing
+    glm::vec3(1.10657, -0.480347, -0.346542),  // left wing
+    glm::vec3(-0.342382, 0.25109, -0.010299),   // right top
+    glm::vec3(0.342382, 0.25109, -0.010299),   // left top
+    glm::vec3(-0.285614, -0.10917, 0.869609), // right front
+    glm::vec3(0.285614, -0.10917, 0.869609), // left front
+    glm::vec3(-0.279064, -0.10917, -0.98846),   // right back
+    glm::vec3(0.279064, -0.10917, -0.98846)   // right back
+};
+
 InputData::InputData()
 {
     w = false;
@@ -28,67 +34,39 @@ InputData::InputData()
     timeStamp = 0;
 }
 
-SpaceShip::SpaceShip() :
-    drBody(0.2f)// server latency
+uint16 InputData::ToBits() const
 {
-    uint32_t numParticles = 2048;
-    this->particleEmitterLeft = new ParticleEmitter(numParticles);
-    this->particleEmitterLeft->data = {
-        .origin = glm::vec4(this->position + (vec3(this->transform[2]) * emitterOffset),1),
-        .dir = glm::vec4(glm::vec3(-this->transform[2]), 0),
-        .startColor = glm::vec4(0.38f, 0.76f, 0.95f, 1.0f) * 2.0f,
-        .endColor = glm::vec4(0,0,0,1.0f),
-        .numParticles = numParticles,
-        .theta = glm::radians(0.0f),
-        .startSpeed = 1.2f,
-        .endSpeed = 0.0f,
-        .startScale = 0.025f,
-        .endScale = 0.0f,
-        .decayTime = 2.58f,
-        .randomTimeOffsetDist = 2.58f,
-        .looping = 1,
-        .emitterType = 1,
-        .discRadius = 0.020f
-    };
-    this->particleEmitterRight = new ParticleEmitter(numParticles);
-    this->particleEmitterRight->data = this->particleEmitterLeft->data;
-
-    ParticleSystem::Instance()->AddEmitter(this->particleEmitterLeft);
-    ParticleSystem::Instance()->AddEmitter(this->particleEmitterRight);
+    return (w ? InputBit_W : 0) | (a ? InputBit_A : 0) | (d ? InputBit_D : 0) |
+        (up ? InputBit_Up : 0) | (down ? InputBit_Down : 0) | (left ? InputBit_Left : 0) |
+        (right ? InputBit_Right : 0) | (space ? InputBit_Space : 0) | (shift ? InputBit_Shift : 0);
 }
 
-SpaceShip::~SpaceShip()
+void InputData::FromBits(uint16 bits)
 {
-    ParticleSystem::Instance()->RemoveEmitter(this->particleEmitterLeft);
-    ParticleSystem::Instance()->RemoveEmitter(this->particleEmitterRight);
+    w = bits & InputBit_W;
+    a = bits & InputBit_A;
+    d = bits & InputBit_D;
+    up = bits & InputBit_Up;
+    down = bits & InputBit_Down;
+    left = bits & InputBit_Left;
+    right = bits & InputBit_Right;
+    space = bits & InputBit_Space;
+    shift = bits & InputBit_Shift;
 }
 
+SpaceShip::SpaceShip() :
+    drBody(0.2f)// server latency
+{}
+
+SpaceShip::~SpaceShip() {}
+
 bool
 SpaceShip::CheckCollisions()
 {
     if (isHit)
         return true;
 
-    glm::mat4 rotation = (glm::mat4)orientation;
-    bool hit = false;
-    for (int i = 0; i < 8; i++)
-    {
-        glm::vec3 pos = position;
-        glm::vec3 dir = rotation * glm::vec4(glm::normalize(colliderEndPoints[i]), 0.0f);
-        float len = glm::length(colliderEndPoints[i]);
-        Physics::RaycastPayload payload = Physics::Raycast(position, dir, len);
-
-        // debug draw collision rays
-        // Debug::DrawLine(pos, pos + dir * len, 1.0f, glm::vec4(0, 1, 0, 1), glm::vec4(0, 1, 0, 1), Debug::RenderMode::AlwaysOnTop);
-
-        if (payload.hit)
-        {
-            Debug::DrawDebugText("HIT", payload.hitPoint, glm::vec4(1, 1, 1, 1));
-            hit = true;
-        }
-    }
-
-    return hit;
+    return CheckAsteroidCollisions(this->position, this->orientation);
 }
 
 void SpaceShip::CompareAndSetImputData(const InputData& data)
@@ -99,96 +77,108 @@ void SpaceShip::CompareAndSetImputData(const InputData& data)
     }
 }
 
-void SpaceShip::FollowThisWithCamera(float dt)
+void
+SpaceShip::ServerUpdate(float dt)
 {
-    Camera* cam = CameraManager::GetCamera(CAMERA_MAIN);
-    // update camera view transform
-    vec3 desiredCamPos = this->position + vec3(this->transform * vec4(0, this->camOffsetY, -4.0f, 0));
-    this->camPos = mix(this->camPos, desiredCamPos, dt * this->cameraSmoothFactor);
-    
-    cam->view = lookAt(this->camPos, this->camPos + vec3(this->transform[2]), vec3(this->transform[1]));
+    vec3 rotationSmooth = vec3(this->rotXSmooth, this->rotYSmooth, this->rotZSmooth);
+    IntegrateShip(this->inputData.ToBits(), dt, this->position, this->orientation, this->linearVelocity,
+        this->currentSpeed, rotationSmooth, this->rotationZ);
+    this->rotXSmooth = rotationSmooth.x;
+    this->rotYSmooth = rotationSmooth.y;
+    this->rotZSmooth = rotationSmooth.z;
+
+    this->transform = translate(this->position) * (mat4)this->orientation;
 }
 
-void
-SpaceShip::ServerUpdate(float dt)
+void SpaceShip::ClientUpdate(float dt, double renderTime)
 {
-    if (this->inputData.w)
+    // dead reckoning keeps running either way, so that switching between the two is seamless
+    DeadRecBody::Body interpBody = this->drBody.Interpolate(dt);
+    if (this->interpolate && this->interpolator.Sample(renderTime, this->position, this->orientation))
     {
-        if (this->inputData.shift)
-            this->currentSpeed = mix(this->currentSpeed, this->boostSpeed, std::min(1.0f, dt * 30.0f));
+        this->linearVelocity = interpBody.velocity;
+        this->transform = translate(this->position) * (mat4)this->orientation;
+        this->currentSpeed = glm::length(this->linearVelocity);
+        return;
+    }
+
+    this->position = interpBody.position;
+    this->linearVelocity = interpBody.velocity;
+    this->orientation = interpBody.orientation;
+
+    this->transform = translate(this->position) * (mat4)this->orientation;
+
+    this->currentSpeed = glm::length(this->linearVelocity);
+}
+
+void SpaceShip::SetServerData(const glm::vec3& serverPos, const glm::vec3& serverVel, const glm::vec3& serverAcc, const glm::quat& serverOri, bool hardReset, uint64 timeStamp)
+{
+    this->drBody.SetDataFromServer({serverPos, serverVel, serverAcc, serverOri}, hardReset, timeStamp);
+
+    // states without a time can't be placed on the playout clock
+    SnapshotInterpolator::State state = { timeStamp, serverPos, serverVel * this->velocityScale, serverOri };
+    if (hardReset)
+    {
+        if (timeStamp != 0)
+            this->interpolator.Reset(state);
         else
-            this->currentSpeed = mix(this->currentSpeed, this->normalSpeed, std::min(1.0f, dt * 90.0f));
+            this->interpolator.Clear();
     }
-    else
+    else if (timeStamp != 0)
     {
-        this->currentSpeed = 0;
+        this->interpolator.Push(state);
     }
+}
 
-    vec3 desiredVelocity = vec3(0, 0, this->currentSpeed);
-    desiredVelocity = this->transform * vec4(desiredVelocity, 0.0f);
+void IntegrateShip(uint16 input, float dt, glm::vec3& position, glm::quat& orientation, glm::vec3& linearVelocity,
+    float& currentSpeed, glm::vec3& rotationSmooth, float& rotationZ)
+{
+    if (input & InputBit_W)
+    {
+        if (input & InputBit_Shift)
+            currentSpeed = mix(currentSpeed, SpaceShip::boostSpeed, std::min(1.0f, dt * 30.0f));
+        else
+            currentSpeed = mix(currentSpeed, SpaceShip::normalSpeed, std::min(1.0f, dt * 90.0f));
+    }
+    else
+    {
+        currentSpeed = 0;
+    }
 
-    this->linearVelocity = mix(this->linearVelocity, desiredVelocity, dt * accelerationFactor);
+    vec3 desiredVelocity = orientation * vec3(0, 0, currentSpeed);
+    linearVelocity = mix(linearVelocity, desiredVelocity, dt * SpaceShip::accelerationFactor);
 
-    float rotX = this->inputData.left ? 1.0f : this->inputData.right ? -1.0f : 0.0f;
-    float rotY = this->inputData.up ? -1.0f : this->inputData.down ? 1.0f : 0.0f;
-    float rotZ = this->inputData.a ? -1.0f : this->inputData.d ? 1.0f : 0.0f;
+    float rotX = (input & InputBit_Left) ? 1.0f : (input & InputBit_Right) ? -1.0f : 0.0f;
+    float rotY = (input & InputBit_Up) ? -1.0f : (input & InputBit_Down) ? 1.0f : 0.0f;
+    float rotZ = (input & InputBit_A) ? -1.0f : (input & InputBit_D) ? 1.0f : 0.0f;
 
-    this->position += this->linearVelocity * dt * 10.0f;
+    position += linearVelocity * dt * SpaceShip::velocityScale;
 
     const float rotationSpeed = 1.8f * dt;
     const float fixedDt = 1.f / 60.f;
-    rotXSmooth = mix(rotXSmooth, rotX * rotationSpeed, cameraSmoothFactor * fixedDt);
-    rotYSmooth = mix(rotYSmooth, rotY * rotationSpeed, cameraSmoothFactor * fixedDt);
-    rotZSmooth = mix(rotZSmooth, rotZ * rotationSpeed, cameraSmoothFactor * fixedDt);
-    quat localOrientation = quat(vec3(-rotYSmooth, rotXSmooth, rotZSmooth));
-    this->orientation = this->orientation * localOrientation;
-
-    this->rotationZ -= rotXSmooth;
-    this->rotationZ = clamp(this->rotationZ, -45.0f, 45.0f);
-    glm::mat4 T = translate(this->position) * (mat4)this->orientation;
-    this->transform = T;
-    //this->transform = T * (mat4)quat(vec3(0, 0, rotationZ));
-    this->rotationZ = mix(this->rotationZ, 0.0f, cameraSmoothFactor * fixedDt);
-
-    const float thrusterPosOffset = 0.365f;
-    this->particleEmitterLeft->data.origin = glm::vec4(vec3(this->position + (vec3(this->transform[0]) * -thrusterPosOffset)) + (vec3(this->transform[2]) * emitterOffset), 1);
-    this->particleEmitterLeft->data.dir = glm::vec4(glm::vec3(-this->transform[2]), 0);
-    this->particleEmitterRight->data.origin = glm::vec4(vec3(this->position + (vec3(this->transform[0]) * thrusterPosOffset)) + (vec3(this->transform[2]) * emitterOffset), 1);
-    this->particleEmitterRight->data.dir = glm::vec4(glm::vec3(-this->transform[2]), 0);
-
-    float t = (this->currentSpeed / this->normalSpeed);
-    this->particleEmitterLeft->data.startSpeed = 1.2 + (3.0f * t);
-    this->particleEmitterLeft->data.endSpeed = 0.0f + (3.0f * t);
-    this->particleEmitterRight->data.startSpeed = 1.2 + (3.0f * t);
-    this->particleEmitterRight->data.endSpeed = 0.0f + (3.0f * t);
+    rotationSmooth = mix(rotationSmooth, vec3(rotX, rotY, rotZ) * rotationSpeed, SpaceShip::cameraSmoothFactor * fixedDt);
+    quat localOrientation = quat(vec3(-rotationSmooth.y, rotationSmooth.x, rotationSmooth.z));
+    orientation = orientation * localOrientation;
+
+    rotationZ -= rotationSmooth.x;
+    rotationZ = clamp(rotationZ, -45.0f, 45.0f);
+    rotationZ = mix(rotationZ, 0.0f, SpaceShip::cameraSmoothFactor * fixedDt);
 }
 
-void SpaceShip::ClientUpdate(float dt)
+bool CheckAsteroidCollisions(const glm::vec3& position, const glm::quat& orientation)
 {
-    DeadRecBody::Body interpBody = this->drBody.Interpolate(dt);
-    this->position = interpBody.position;
-    this->linearVelocity = interpBody.velocity;
-    this->orientation = interpBody.orientation;
-
-    this->transform = translate(this->position) * (mat4)this->orientation;
-
-    this->currentSpeed = glm::length(this->linearVelocity);
+    glm::mat4 rotation = (glm::mat4)orientation;
+    bool hit = false;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 dir = rotation * glm::vec4(glm::normalize(colliderEndPoints[i]), 0.0f);
+        float len = glm::length(colliderEndPoints[i]);
+        Physics::RaycastPayload payload = Physics::Raycast(position, dir, len);
 
-    const float thrusterPosOffset = 0.365f;
-    this->particleEmitterLeft->data.origin = glm::vec4(vec3(this->position + (vec3(this->transform[0]) * -thrusterPosOffset)) + (vec3(this->transform[2]) * emitterOffset), 1);
-    this->particleEmitterLeft->data.dir = glm::vec4(glm::vec3(-this->transform[2]), 0);
-    this->particleEmitterRight->data.origin = glm::vec4(vec3(this->position + (vec3(this->transform[0]) * thrusterPosOffset)) + (vec3(this->transform[2]) * emitterOffset), 1);
-    this->particleEmitterRight->data.dir = glm::vec4(glm::vec3(-this->transform[2]), 0);
-
-    float t = (this->currentSpeed / this->normalSpeed);
-    this->particleEmitterLeft->data.startSpeed = 1.2 + (3.0f * t);
-    this->particleEmitterLeft->data.endSpeed = 0.0f + (3.0f * t);
-    this->particleEmitterRight->data.startSpeed = 1.2 + (3.0f * t);
-    this->particleEmitterRight->data.endSpeed = 0.0f + (3.0f * t);
-}
+        if (payload.hit)
+            hit = true;
+    }
 
-void SpaceShip::SetServerData(const glm::vec3& serverPos, const glm::vec3& serverVel, const glm::vec3& serverAcc, const glm::quat& serverOri, bool hardReset, uint64 timeStamp)
-{
-    this->drBody.SetDataFromServer({serverPos, serverVel, serverAcc, serverOri}, hardReset, timeStamp);
+    return hit;
 }
 }
\ No newline at end of file
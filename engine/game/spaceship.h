@@ -1,13 +1,23 @@
 #pragma once
 #include "dead_rec.h"
+#include "interpolator.h"
 
-namespace Render
+namespace Game
 {
-    struct ParticleEmitter;
-}
 
-namespace Game
+// the keys of an InputC2S bitmap
+enum InputBit : uint16
 {
+    InputBit_W = 1 << 0,
+    InputBit_A = 1 << 1,
+    InputBit_D = 1 << 2,
+    InputBit_Up = 1 << 3,
+    InputBit_Down = 1 << 4,
+    InputBit_Left = 1 << 5,
+    InputBit_Right = 1 << 6,
+    InputBit_Space = 1 << 7,
+    InputBit_Shift = 1 << 8
+};
 
 struct InputData
 {
@@ -15,6 +25,9 @@ struct InputData
     uint64 timeStamp;
 
     InputData();
+
+    uint16 ToBits() const;
+    void FromBits(uint16 bits);
 };
 
 struct SpaceShip
@@ -29,15 +42,16 @@ struct SpaceShip
     glm::vec3 linearVelocity = glm::vec3(0);
 
     DeadRecBody drBody;
+    SnapshotInterpolator interpolator;
+    bool interpolate = false;// on clients, sample the interpolator instead of dead reckoning
 
-    glm::vec3 camPos = glm::vec3(0, 1.0f, -2.0f);
     glm::mat4 transform = glm::mat4(1);
 
-    const float normalSpeed = 1.0f;
-    const float boostSpeed = normalSpeed * 2.0f;
-    const float accelerationFactor = 1.0f;
-    const float camOffsetY = 1.0f;
-    const float cameraSmoothFactor = 10.0f;
+    static constexpr float normalSpeed = 1.0f;
+    static constexpr float boostSpeed = normalSpeed * 2.0f;
+    static constexpr float velocityScale = 10.0f;// units per second the position moves for each unit of linearVelocity
+    static constexpr float accelerationFactor = 1.0f;
+    static constexpr float cameraSmoothFactor = 10.0f;
 
     float currentSpeed = 0.0f;
 
@@ -46,30 +60,22 @@ struct SpaceShip
     float rotYSmooth = 0;
     float rotZSmooth = 0;
 
-    Render::ParticleEmitter* particleEmitterLeft;
-    Render::ParticleEmitter* particleEmitterRight;
-    float emitterOffset = -0.5f;
-
     uint32 id = 0;
     bool isHit = false;
     float timeSinceLastLaser = 0.f;
 
     bool CheckCollisions();
     void CompareAndSetImputData(const InputData& data);
-    void FollowThisWithCamera(float dt);
     void ServerUpdate(float dt);
-    void ClientUpdate(float dt);
+    // renderTime is the server time remote ships are drawn at, see PlayoutClock
+    void ClientUpdate(float dt, double renderTime);
     void SetServerData(const glm::vec3& serverPos, const glm::vec3& serverVel, const glm::vec3& serverAcc, const glm::quat& serverOri, bool hardReset, uint64 timeStamp);
-    
-    const glm::vec3 colliderEndPoints[8] = {
-        glm::vec3(-1.10657, -0.480347, -0.346542),  // right wing
-        glm::vec3(1.10657, -0.480347, -0.346542),  // left wing
-        glm::vec3(-0.342382, 0.25109, -0.010299),   // right top
-        glm::vec3(0.342382, 0.25109, -0.010299),   // left top
-        glm::vec3(-0.285614, -0.10917, 0.869609), // right front
-        glm::vec3(0.285614, -0.10917, 0.869609), // left front
-        glm::vec3(-0.279064, -0.10917, -0.98846),   // right back
-        glm::vec3(0.279064, -0.10917, -0.98846)   // right back
-    };
 };
+
+// one tick of a ship's movement on an InputBit mask, what a client predicts its ship with. the server moves its
+// ships with IntegrateShips instead, which agrees with this to within shipIntegrateTolerance a tick
+void IntegrateShip(uint16 input, float dt, glm::vec3& position, glm::quat& orientation, glm::vec3& linearVelocity,
+    float& currentSpeed, glm::vec3& rotationSmooth, float& rotationZ);
+// true if the ship's hull reaches into an asteroid
+bool CheckAsteroidCollisions(const glm::vec3& position, const glm::quat& orientation);
 }
\ No newline at end of file
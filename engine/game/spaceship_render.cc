@@ -0,0 +1,83 @@
+#include "config.h"
+#include "spaceship_render.h"
+#include "render/cameramanager.h"
+#include "render/particlesystem.h"
+
+using namespace glm;
+using namespace Render;
+
+namespace Game
+{
+
+SpaceShipRender::SpaceShipRender()
+{
+    uint32_t numParticles = 2048;
+    this->particleEmitterLeft = new ParticleEmitter(numParticles);
+    this->particleEmitterLeft->data = {
+        .origin = glm::vec4(glm::vec3(0, 0, emitterOffset), 1),
+        .dir = glm::vec4(glm::vec3(0, 0, -1), 0),
+        .startColor = glm::vec4(0.38f, 0.76f, 0.95f, 1.0f) * 2.0f,
+        .endColor = glm::vec4(0,0,0,1.0f),
+        .numParticles = numParticles,
+        .theta = glm::radians(0.0f),
+        .startSpeed = 1.2f,
+        .endSpeed = 0.0f,
+        .startScale = 0.025f,
+        .endScale = 0.0f,
+        .decayTime = 2.58f,
+        .randomTimeOffsetDist = 2.58f,
+        .looping = 1,
+        .emitterType = 1,
+        .discRadius = 0.020f
+    };
+    this->particleEmitterRight = new ParticleEmitter(numParticles);
+    this->particleEmitterRight->data = this->particleEmitterLeft->data;
+
+    ParticleSystem::Instance()->AddEmitter(this->particleEmitterLeft);
+    ParticleSystem::Instance()->AddEmitter(this->particleEmitterRight);
+}
+
+SpaceShipRender::~SpaceShipRender()
+{
+    ParticleSystem::Instance()->RemoveEmitter(this->particleEmitterLeft);
+    ParticleSystem::Instance()->RemoveEmitter(this->particleEmitterRight);
+    delete this->particleEmitterLeft;
+    delete this->particleEmitterRight;
+}
+
+void SpaceShipRender::Update(const SpaceShip& spaceShip)
+{
+    this->Update(spaceShip.transform, spaceShip.currentSpeed);
+}
+
+void SpaceShipRender::FollowWithCamera(const SpaceShip& spaceShip, float dt)
+{
+    this->FollowWithCamera(spaceShip.transform, dt);
+}
+
+void SpaceShipRender::Update(const glm::mat4& transform, float currentSpeed)
+{
+    const vec3 position = vec3(transform[3]);
+    const float thrusterPosOffset = 0.365f;
+    this->particleEmitterLeft->data.origin = glm::vec4(vec3(position + (vec3(transform[0]) * -thrusterPosOffset)) + (vec3(transform[2]) * emitterOffset), 1);
+    this->particleEmitterLeft->data.dir = glm::vec4(glm::vec3(-transform[2]), 0);
+    this->particleEmitterRight->data.origin = glm::vec4(vec3(position + (vec3(transform[0]) * thrusterPosOffset)) + (vec3(transform[2]) * emitterOffset), 1);
+    this->particleEmitterRight->data.dir = glm::vec4(glm::vec3(-transform[2]), 0);
+
+    float t = (currentSpeed / SpaceShip::normalSpeed);
+    this->particleEmitterLeft->data.startSpeed = 1.2 + (3.0f * t);
+    this->particleEmitterLeft->data.endSpeed = 0.0f + (3.0f * t);
+    this->particleEmitterRight->data.startSpeed = 1.2 + (3.0f * t);
+    this->particleEmitterRight->data.endSpeed = 0.0f + (3.0f * t);
+}
+
+void SpaceShipRender::FollowWithCamera(const glm::mat4& transform, float dt)
+{
+    Camera* cam = CameraManager::GetCamera(CAMERA_MAIN);
+    // update camera view transform
+    vec3 desiredCamPos = vec3(transform[3]) + vec3(transform * vec4(0, this->camOffsetY, -4.0f, 0));
+    this->camPos = mix(this->camPos, desiredCamPos, dt * this->cameraSmoothFactor);
+    
+    cam->view = lookAt(this->camPos, this->camPos + vec3(transform[2]), vec3(transform[1]));
+}
+}
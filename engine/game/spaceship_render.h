@@ -0,0 +1,32 @@
+#pragma once
+#include "spaceship.h"
+
+namespace Render
+{
+    struct ParticleEmitter;
+}
+
+namespace Game
+{
+// render side of a space ship, kept apart from SpaceShip so that the simulation can run without a GL context
+struct SpaceShipRender
+{
+    SpaceShipRender();
+    ~SpaceShipRender();
+
+    glm::vec3 camPos = glm::vec3(0, 1.0f, -2.0f);
+
+    const float camOffsetY = 1.0f;
+    const float cameraSmoothFactor = 10.0f;
+
+    Render::ParticleEmitter* particleEmitterLeft;
+    Render::ParticleEmitter* particleEmitterRight;
+    float emitterOffset = -0.5f;
+
+    void Update(const SpaceShip& spaceShip);
+    void FollowWithCamera(const SpaceShip& spaceShip, float dt);
+    // for ships that aren't kept as a SpaceShip, like the server's
+    void Update(const glm::mat4& transform, float currentSpeed);
+    void FollowWithCamera(const glm::mat4& transform, float dt);
+};
+}
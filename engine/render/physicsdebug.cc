@@ -0,0 +1,316 @@
+//------------------------------------------------------------------------------
+//  @file physicsdebug.cc
+//  @copyright (C) 2022 Individual contributors, see AUTHORS file
+//------------------------------------------------------------------------------
+#include "config.h"
+#include "physics.h"
+#include "debugrender.h"
+#include "core/random.h"
+#include "core/cvar.h"
+#include <chrono>
+#include <iostream>
+namespace Physics
+{
+
+struct AABB
+{
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    void Grow(glm::vec3 const& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    float Area()
+    {
+        glm::vec3 extent = max - min; // box extent
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+};
+
+struct Bin { AABB bounds; int count = 0; };
+
+static const uint N_OBJECTS = 1000;
+
+static glm::vec3 objects[N_OBJECTS];
+static AABB bboxes[N_OBJECTS];
+
+struct BVHNode
+{
+    AABB bbox;
+    uint index = -1; // left node, or index to first child if count is zero
+    uint count = 0; // number of children
+};
+
+struct BVH
+{
+    BVHNode* nodes = nullptr;
+    uint* bboxIndex = nullptr;
+    uint rootNodeIndex = 0;
+    uint nodesUsed = 0;
+};
+
+void UpdateNodeBounds(BVH* bvh, BVHNode* node);
+void Subdivide(BVH* bvh, BVHNode* node);
+
+BVH* BuildBVH(uint numObjects)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    BVH* bvh = new BVH();
+    bvh->nodes = new BVHNode[numObjects * 2 - 1];
+    bvh->nodesUsed = 1;
+    bvh->bboxIndex = new uint[numObjects];
+    for (uint i = 0; i < numObjects; i++)
+        bvh->bboxIndex[i] = i;
+
+    BVHNode& root = bvh->nodes[bvh->rootNodeIndex];
+    root.index = 0;
+    root.count = numObjects;
+    UpdateNodeBounds(bvh, &root);
+    // subdivide recursively
+    Subdivide(bvh, &root);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> duration = stop - start;
+ 
+    std::cout << "buildbvh: " << duration.count() << std::endl;
+
+    return bvh;
+}
+
+void UpdateNodeBounds(BVH* bvh, BVHNode* node)
+{
+    node->bbox.min = glm::vec3(1e30f);
+    node->bbox.max = glm::vec3(-1e30f);
+    uint end = node->index + node->count;
+    for (uint i = node->index; i < end; i++)
+    {
+        uint index = bvh->bboxIndex[i];
+        AABB& leafBBox = bboxes[index];
+        node->bbox.min = glm::min(node->bbox.min, leafBBox.min);
+        node->bbox.max = glm::max(node->bbox.max, leafBBox.max);
+    }
+}
+
+// surface area heuristic
+float EvaluateSAH(BVH* bvh, BVHNode* node, int axis, float pos)
+{
+    // determine triangle counts and bounds for this split candidate
+    AABB leftBox, rightBox;
+    int leftCount = 0, rightCount = 0;
+    for (uint i = 0; i < node->count; i++)
+    {
+        AABB const& bbox = bboxes[bvh->bboxIndex[node->index + i]];
+        float center = (bbox.max[axis] + bbox.min[axis]) * 0.5f;
+        if (center < pos)
+        {
+            leftCount++;
+            leftBox.Grow(bbox.min);
+            leftBox.Grow(bbox.max);
+        }
+        else
+        {
+            rightCount++;
+            rightBox.Grow(bbox.min);
+            rightBox.Grow(bbox.max);
+        }
+    }
+    float cost = leftCount * leftBox.Area() + rightCount * rightBox.Area();
+    return cost > 0 ? cost : 1e30f;
+}
+
+float FindBestSplitPlane(BVH* bvh, BVHNode* node, int& axis, float& splitPos)
+{
+    constexpr int intervals = 8;
+    float bestCost = 1e30f;
+    for (int a = 0; a < 3; a++)
+    {
+        float boundsMin = 1e30f, boundsMax = -1e30f;
+        for (uint i = 0; i < node->count; i++)
+        {
+            AABB const& bbox = bboxes[bvh->bboxIndex[node->index + i]];
+            float center = (bbox.max[a] + bbox.min[a]) * 0.5f;
+            boundsMin = glm::min(boundsMin, center);
+            boundsMax = glm::max(boundsMax, center);
+        }
+        if (boundsMin == boundsMax) continue;
+        // populate the bins
+        Bin bin[intervals];
+        float scale = (float)intervals / (boundsMax - boundsMin);
+        for (uint i = 0; i < node->count; i++)
+        {
+            AABB const& bbox = bboxes[bvh->bboxIndex[node->index + i]];
+            float center = (bbox.max[a] + bbox.min[a]) * 0.5f;
+            int binIdx = glm::min(intervals - 1, (int)((center - boundsMin) * scale));
+            bin[binIdx].count++;
+            bin[binIdx].bounds.Grow(bbox.min);
+            bin[binIdx].bounds.Grow(bbox.max);
+        }
+        // gather data for the 7 planes between the 8 bins
+        float leftArea[intervals - 1], rightArea[intervals - 1];
+        int leftCount[intervals - 1], rightCount[intervals - 1];
+        AABB leftBox, rightBox;
+        int leftSum = 0, rightSum = 0;
+        for (int i = 0; i < intervals - 1; i++)
+        {
+            leftSum += bin[i].count;
+            leftCount[i] = leftSum;
+            leftBox.Grow(bin[i].bounds.min);
+            leftBox.Grow(bin[i].bounds.max);
+            leftArea[i] = leftBox.Area();
+            rightSum += bin[intervals - 1 - i].count;
+            rightCount[intervals - 2 - i] = rightSum;
+            rightBox.Grow(bin[intervals - 1 - i].bounds.min);
+            rightBox.Grow(bin[intervals - 1 - i].bounds.max);
+            rightArea[intervals - 2 - i] = rightBox.Area();
+        }
+        // calculate SAH cost for the 7 planes
+        scale = (boundsMax - boundsMin) / intervals;
+        for (int i = 0; i < intervals - 1; i++)
+        {
+            float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (planeCost < bestCost)
+                axis = a, splitPos = boundsMin + scale * (i + 1), bestCost = planeCost;
+        }
+    }
+    return bestCost;
+}
+
+float CalculateNodeCost(BVHNode* node)
+{
+    return node->count * node->bbox.Area();
+}
+
+void Subdivide(BVH* bvh, BVHNode* node)
+{
+    if (node->count <= 2) return;
+
+    // calculate splitting plane
+    //glm::vec3 extent = node->bbox.max - node->bbox.min;
+    //int axis = 0;
+    //if (extent.y > extent.x) axis = 1;
+    //if (extent.z > extent[axis]) axis = 2;
+    //float splitPos = node->bbox.min[axis] + (extent[axis] * 0.5f);
+
+    int axis;
+    float splitPos;
+    float splitCost = FindBestSplitPlane(bvh, node, axis, splitPos);
+    float nosplitCost = CalculateNodeCost(node);
+    if (splitCost >= nosplitCost) return;
+
+
+    // split group into two halves
+    // just swap elements to be to the left or right of a split in the aabb array
+    int i = node->index;
+    int j = i + node->count - 1;
+    while (i <= j)
+    {
+        const uint idx = bvh->bboxIndex[i];
+        float center = (bboxes[idx].min[axis] + bboxes[idx].max[axis]) * 0.5f;
+        if (center < splitPos)
+            i++;
+        else
+            std::swap(bvh->bboxIndex[i], bvh->bboxIndex[j--]);
+    }
+
+    int leftCount = i - node->index;
+    if (leftCount == 0 || leftCount == node->count) return;
+    // create child nodes
+    int leftChildIdx = bvh->nodesUsed++;
+    int rightChildIdx = bvh->nodesUsed++;
+    bvh->nodes[leftChildIdx].index = node->index;
+    bvh->nodes[leftChildIdx].count = leftCount;
+    bvh->nodes[rightChildIdx].index = i;
+    bvh->nodes[rightChildIdx].count = node->count - leftCount;
+    node->index = leftChildIdx;
+    node->count = 0;
+    UpdateNodeBounds(bvh, bvh->nodes + leftChildIdx);
+    UpdateNodeBounds(bvh, bvh->nodes + rightChildIdx);
+    Subdivide(bvh, bvh->nodes + leftChildIdx);
+    Subdivide(bvh, bvh->nodes + rightChildIdx);
+}
+
+BVH* bvh;
+void SetupBVH()
+{
+    Core::CVar* debug_bvh_mode = Core::CVarCreate(Core::CVarType::CVar_Int, "debug_bvh_mode", "3");
+    Core::CVar* debug_bvh_maxdepth = Core::CVarCreate(Core::CVarType::CVar_Int, "debug_bvh_maxdepth", "60");
+    Core::CVar* debug_bvh_node_index = Core::CVarCreate(Core::CVarType::CVar_Int, "debug_bvh_node_index", "0");
+
+    for (size_t i = 0; i < N_OBJECTS; i++)
+    {
+        const float span = 5.0f;
+        objects[i] = glm::vec3(Core::RandomFloatNTP() * span, Core::RandomFloatNTP() * span, Core::RandomFloatNTP() * span);
+        const float maxSize = 0.2f;
+        const float minSize = 0.02f;
+        glm::vec3 halfExtents = glm::vec3((minSize + Core::RandomFloat() * maxSize), (minSize + Core::RandomFloat() * maxSize), (minSize + Core::RandomFloat() * maxSize));
+        bboxes[i] = { objects[i] - halfExtents, objects[i] + halfExtents };
+    }
+    
+    bvh = BuildBVH(N_OBJECTS);
+}
+
+void DrawBVH(BVHNode* node, int depth, int maxDepth)
+{
+    if (depth == maxDepth) return;
+
+    glm::vec3 center = (node->bbox.max + node->bbox.min) / 2.0f;
+    Debug::DrawBox(glm::translate(center) * glm::scale(node->bbox.max - node->bbox.min), glm::vec4(glm::vec3(1), 1), Debug::RenderMode::WireFrame);
+
+    if (node->count > 0)
+    {
+        // leaf node
+    }
+    else
+    {
+        DrawBVH(bvh->nodes + node->index, depth + 1, maxDepth);
+        DrawBVH(bvh->nodes + node->index + 1, depth + 1, maxDepth);
+    }
+}
+
+void VisualizeBVH()
+{
+    Core::CVar* debug_bvh_mode = Core::CVarGet("debug_bvh_mode");
+    Core::CVar* debug_bvh_maxdepth = Core::CVarGet("debug_bvh_maxdepth");
+
+    static glm::vec4 colors[N_OBJECTS];
+    static bool once = true;
+    for (size_t i = 0; once && i < N_OBJECTS; i++)
+    {
+        colors[i] = glm::vec4(Core::RandomFloat(), Core::RandomFloat(), Core::RandomFloat(), 1);
+    } once = false;
+
+    const int mode = Core::CVarReadInt(debug_bvh_mode);
+    if (mode == 4)
+    {
+        const uint index = (uint)Core::CVarReadInt(Core::CVarGet("debug_bvh_node_index"));
+        BVHNode* node = bvh->nodes + glm::min(index, bvh->nodesUsed - 1);
+        const glm::vec3 center = (node->bbox.max + node->bbox.min) / 2.0f;
+        Debug::DrawBox(glm::translate(center) * glm::scale(node->bbox.max - node->bbox.min), glm::vec4(glm::vec3(1), 1), Debug::RenderMode::WireFrame);
+    }
+    else
+    {
+        if (mode > 2)
+        { // Draw objects and bboxes
+            for (size_t i = 0; i < N_OBJECTS; i++)
+            {
+                Debug::DrawBox(glm::translate(objects[i]) * glm::scale(glm::vec3(0.015f)), { 1,1,1,1 });
+            }
+
+            for (size_t i = 0; i < N_OBJECTS; i++)
+            {
+                Debug::DrawBox(glm::translate(objects[i]) * glm::scale(bboxes[i].max - bboxes[i].min), colors[i], Debug::RenderMode::WireFrame);
+            }
+        }
+
+        if (mode > 1)
+        {
+            const int maxDepth = Core::CVarReadInt(debug_bvh_maxdepth);
+            DrawBVH(bvh->nodes, 0, maxDepth);
+        }
+    }
+}
+
+} // namespace Physics
@@ -0,0 +1,140 @@
+#include "config.h"
+#include "game/broadphase.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// CollisionGrid against testing every pair, usage: bench_broadphase [--check]. --check only compares the two
+
+typedef std::chrono::steady_clock Clock;
+
+static const float collisionDistance = 2.f;// the server's ship collision radius
+
+// every pair closer than the distance, the way ships were tested before the grid
+static void BruteForcePairs(const std::vector<glm::vec3>& positions, float distanceSquared, std::vector<Game::CollisionPair>& outPairs)
+{
+	for (uint32 a = 0; a < (uint32)positions.size(); a++)
+	{
+		for (uint32 b = a + 1; b < (uint32)positions.size(); b++)
+		{
+			glm::vec3 diff = positions[b] - positions[a];
+			if (glm::dot(diff, diff) < distanceSquared)
+				outPairs.push_back({ a, b });
+		}
+	}
+}
+
+static void SortPairs(std::vector<Game::CollisionPair>& pairs)
+{
+	std::sort(pairs.begin(), pairs.end(),
+		[](const Game::CollisionPair& x, const Game::CollisionPair& y) { return x.a < y.a || (x.a == y.a && x.b < y.b); });
+}
+
+// ships in a ball around the asteroid field, a few of them right on cell boundaries
+static std::vector<glm::vec3> MakePositions(size_t count, float radius, uint32 seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	std::vector<glm::vec3> positions;
+	while (positions.size() < count)
+	{
+		glm::vec3 p(unit(rng), unit(rng), unit(rng));
+		if (glm::dot(p, p) > 1.f)
+			continue;
+
+		p *= radius;
+		if (positions.size() % 16 == 0)
+			p = glm::round(p / collisionDistance) * collisionDistance;
+		positions.push_back(p);
+	}
+	return positions;
+}
+
+static bool CheckPairs(size_t count, float radius)
+{
+	std::vector<glm::vec3> positions = MakePositions(count, radius, (uint32)count);
+	std::vector<Game::CollisionPair> expected;
+	BruteForcePairs(positions, collisionDistance * collisionDistance, expected);
+
+	Game::CollisionGrid grid;
+	std::vector<Game::CollisionPair> found;
+	grid.Build(positions.data(), positions.size(), collisionDistance);
+	grid.FindPairs(collisionDistance * collisionDistance, found);
+
+	for (const Game::CollisionPair& pair : found)
+	{
+		if (pair.a >= pair.b)
+		{
+			std::printf("pairs %4zu ships in radius %g: pair %u %u is not ordered: FAILED\n", count, radius, pair.a, pair.b);
+			return false;
+		}
+	}
+
+	SortPairs(expected);
+	SortPairs(found);
+	bool same = expected.size() == found.size() &&
+		std::equal(expected.begin(), expected.end(), found.begin(),
+			[](const Game::CollisionPair& x, const Game::CollisionPair& y) { return x.a == y.a && x.b == y.b; });
+	std::printf("pairs %4zu ships in radius %g: %zu expected, %zu found: %s\n", count, radius, expected.size(), found.size(), same ? "ok" : "FAILED");
+	return same;
+}
+
+template<typename FindPairs>
+static double Microseconds(FindPairs findPairs)
+{
+	const int numRuns = 50;
+	auto start = Clock::now();
+	for (int run = 0; run < numRuns; run++)
+		findPairs();
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / (double)numRuns;
+}
+
+static void BenchPairs(size_t count, float radius)
+{
+	std::vector<glm::vec3> positions = MakePositions(count, radius, (uint32)count);
+	std::vector<Game::CollisionPair> pairs;
+	Game::CollisionGrid grid;
+
+	double bruteForce = Microseconds([&]()
+	{
+		pairs.clear();
+		BruteForcePairs(positions, collisionDistance * collisionDistance, pairs);
+	});
+
+	// built every tick on the server, so the build is part of the cost
+	double gridTime = Microseconds([&]()
+	{
+		pairs.clear();
+		grid.Build(positions.data(), positions.size(), collisionDistance);
+		grid.FindPairs(collisionDistance * collisionDistance, pairs);
+	});
+
+	std::printf("pairs %4zu ships in radius %g: brute force %9.1f us, grid %7.1f us, %.1fx\n", count, radius, bruteForce, gridTime, bruteForce / gridTime);
+}
+
+int
+main(int argc, const char** argv)
+{
+	bool checkOnly = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+
+	// spread out as in a game, and packed so tightly that most cells hold several ships
+	bool ok = true;
+	for (size_t count : { 64, 512, 4096 })
+	{
+		ok = CheckPairs(count, 150.f) && ok;
+		ok = CheckPairs(count, 20.f) && ok;
+	}
+
+	if (!checkOnly)
+	{
+		for (size_t count : { 64, 512, 4096 })
+		{
+			BenchPairs(count, 150.f);
+			BenchPairs(count, 20.f);
+		}
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+#include "config.h"
+#include "game/network.h"
+#include "game/quantize.h"
+#include "../build/generated/flat/proto.h"// include directory doesn't want to work in cmake :(
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// a server and its clients in one process over localhost, usage: bench_network [port]
+
+static const size_t messageSize = 32;// about a player delta
+
+typedef std::chrono::steady_clock Clock;
+
+// every heap allocation in the process, through operator new or ENet's allocator
+static std::atomic<uint64> numAllocations(0);
+
+void* operator new(size_t size)
+{
+	numAllocations++;
+	if (void* memory = std::malloc(size != 0 ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+static void* CountedMalloc(size_t size)
+{
+	numAllocations++;
+	return std::malloc(size);
+}
+
+static double Seconds(Clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+// any finished buffer will do, the host never looks inside
+static void BuildMessage(Game::MessageBuilder& message, uint32 sequence)
+{
+	uint8 payload[messageSize];
+	std::memset(payload, (int)(sequence & 0xff), sizeof(payload));
+	message.builder.Finish(message.builder.CreateVector(payload, sizeof(payload)));
+}
+
+struct Connection
+{
+	Game::Server server;
+	std::vector<Game::Client*> clients;
+	size_t numConnected = 0;
+
+	~Connection()
+	{
+		for (Game::Client* client : clients)
+			delete client;
+	}
+
+	bool Open(enet_uint16 port, size_t numClients)
+	{
+		if (!server.Initialize("127.0.0.1", port, numClients, [](ENetPeer*) {}, [](ENetPeer*) {}))
+			return false;
+
+		for (size_t i = 0; i < numClients; i++)
+		{
+			Game::Client* client = new Game::Client();
+			clients.push_back(client);
+			if (!client->Initialize([this](ENetPeer*) { numConnected++; }, [](ENetPeer*) {}) || !client->RequestConnectionToServer("127.0.0.1", port))
+				return false;
+		}
+
+		auto deadline = Clock::now() + std::chrono::seconds(5);
+		while ((numConnected < numClients || server.connectedPeers.size() < numClients) && Clock::now() < deadline)
+			Update();
+
+		return numConnected == numClients && server.connectedPeers.size() == numClients;
+	}
+
+	// services every host once and throws away whatever they received
+	void Update()
+	{
+		server.Update();
+		server.ReleaseReceivedData();
+		for (Game::Client* client : clients)
+		{
+			client->Update();
+			client->ReleaseReceivedData();
+		}
+	}
+};
+
+// messages per second the server gets through Update and PopData, from one client sending reliable batches
+static bool BenchReceive(enet_uint16 port)
+{
+	Connection connection;
+	if (!connection.Open(port, 1))
+	{
+		std::printf("receive: failed to connect\n");
+		return false;
+	}
+
+	Game::Client& client = *connection.clients[0];
+	Game::Server& server = connection.server;
+
+	const size_t batchSize = 256;
+	const size_t numMessages = batchSize * 800;
+	size_t numReceived = 0;
+	size_t numBytes = 0;
+	Clock::duration receiveTime(0);
+	auto deadline = Clock::now() + std::chrono::seconds(30);
+
+	for (size_t sent = 0; sent < numMessages && Clock::now() < deadline; sent += batchSize)
+	{
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			Game::MessageBuilder message;
+			BuildMessage(message, (uint32)(sent + i));
+			client.SendData(message, client.server, Game::Channel::Events);
+		}
+		client.Flush();
+
+		// only the server's side is timed, the client just has to keep up with the acknowledgements
+		while (numReceived < sent + batchSize && Clock::now() < deadline)
+		{
+			auto start = Clock::now();
+			server.Update();
+			Game::Data data;
+			while (server.PopData(data))
+			{
+				numBytes += data.GetSize();
+				numReceived++;
+			}
+			server.ReleaseReceivedData();
+			receiveTime += Clock::now() - start;
+
+			client.Update();
+			client.ReleaseReceivedData();
+		}
+	}
+
+	double seconds = Seconds(receiveTime);
+	std::printf("receive: %zu messages of %zu bytes in %.3f s, %.0f messages/s through Update + PopData\n",
+		numReceived, numBytes / std::max(numReceived, (size_t)1), seconds, (double)numReceived / std::max(seconds, 1e-9));
+	return numReceived == numMessages;
+}
+
+// packets against datagrams for a server sending a tick's worth of messages to each of 32 peers, flushed after
+// every message the way sends used to be, and once at the end of the tick
+static bool BenchFlush(enet_uint16 port, bool flushEachMessage)
+{
+	Connection connection;
+	if (!connection.Open(port, 32))
+	{
+		std::printf("flush: failed to connect\n");
+		return false;
+	}
+
+	Game::Server& server = connection.server;
+	const size_t numTicks = 200;
+	const size_t messagesPerPeer = 8;
+	Clock::duration sendTime(0);
+
+	Game::SendCounters before = server.GetSendCounters();
+	for (size_t tick = 0; tick < numTicks; tick++)
+	{
+		auto start = Clock::now();
+		for (ENetPeer* peer : server.connectedPeers)
+		{
+			for (size_t i = 0; i < messagesPerPeer; i++)
+			{
+				Game::MessageBuilder message;
+				BuildMessage(message, (uint32)(tick * messagesPerPeer + i));
+				server.SendData(message, peer, Game::Channel::State);
+				if (flushEachMessage)
+					server.Flush();
+			}
+		}
+		server.Flush();
+		sendTime += Clock::now() - start;
+
+		connection.Update();
+	}
+	Game::SendCounters after = server.GetSendCounters();
+
+	uint64 packets = after.packets - before.packets;
+	uint64 datagrams = after.datagrams - before.datagrams;
+	std::printf("flush %s: %zu peers, %llu packets in %llu datagrams, %.1f datagrams per tick, %.3f ms per tick sending\n",
+		flushEachMessage ? "per message" : "per tick  ", server.connectedPeers.size(),
+		(unsigned long long)packets, (unsigned long long)datagrams, (double)datagrams / (double)numTicks, Seconds(sendTime) * 1000.0 / (double)numTicks);
+	return true;
+}
+
+// heap allocations per tick for the 32 peer tick above, messages built in pooled builders and sent in place,
+// against a fresh FlatBufferBuilder per message whose bytes ENet copies, the way messages used to be sent
+static bool BenchAllocations(enet_uint16 port, bool pooled)
+{
+	Connection connection;
+	if (!connection.Open(port, 32))
+	{
+		std::printf("allocations: failed to connect\n");
+		return false;
+	}
+
+	Game::Server& server = connection.server;
+	const size_t numWarmupTicks = 10;// until the builder pool and ENet's queues have grown
+	const size_t numTicks = 200;
+	const size_t messagesPerPeer = 8;
+	uint64 allocations = 0;
+
+	for (size_t tick = 0; tick < numWarmupTicks + numTicks; tick++)
+	{
+		uint64 before = numAllocations;
+		for (ENetPeer* peer : server.connectedPeers)
+		{
+			for (size_t i = 0; i < messagesPerPeer; i++)
+			{
+				uint32 sequence = (uint32)(tick * messagesPerPeer + i);
+				if (pooled)
+				{
+					Game::MessageBuilder message;
+					BuildMessage(message, sequence);
+					server.SendData(message, peer, Game::Channel::State);
+					continue;
+				}
+
+				uint8 payload[messageSize];
+				std::memset(payload, (int)(sequence & 0xff), sizeof(payload));
+				flatbuffers::FlatBufferBuilder builder;
+				builder.Finish(builder.CreateVector(payload, sizeof(payload)));
+				ENetPacket* packet = enet_packet_create(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+				enet_peer_send(peer, (enet_uint8)Game::Channel::State, packet);
+			}
+		}
+		server.Flush();
+		if (tick >= numWarmupTicks)
+			allocations += numAllocations - before;
+
+		connection.Update();
+	}
+
+	size_t numMessages = server.connectedPeers.size() * messagesPerPeer;
+	std::printf("allocations %s: %.1f per tick for %zu messages, %.2f per message\n",
+		pooled ? "pooled" : "fresh ", (double)allocations / (double)numTicks, numMessages, (double)allocations / (double)(numTicks * numMessages));
+	return true;
+}
+
+// a tick of ship state for 32 clients, the way it used to go out with one UpdatePlayerS2C per ship broadcast
+// and flushed on its own, against one WorldSnapshotS2C with every ship per peer and a single flush
+static bool BenchSnapshots(enet_uint16 port, bool batched)
+{
+	Connection connection;
+	if (!connection.Open(port, 32))
+	{
+		std::printf("snapshots: failed to connect\n");
+		return false;
+	}
+
+	Game::Server& server = connection.server;
+	const size_t numTicks = 200;
+	const uint32 numShips = (uint32)server.connectedPeers.size();// one per client
+	Clock::duration sendTime(0);
+
+	Game::SendCounters before = server.GetSendCounters();
+	for (size_t tick = 0; tick < numTicks; tick++)
+	{
+		auto start = Clock::now();
+		if (batched)
+		{
+			for (ENetPeer* peer : server.connectedPeers)
+			{
+				Game::MessageBuilder message;
+				std::vector<flatbuffers::Offset<Protocol::PlayerDelta>> p_players;
+				for (uint32 id = 0; id < numShips; id++)
+				{
+					auto p_position = Protocol::QuantizedVec3((int16)(id + tick), (int16)id, (int16)tick);
+					auto p_velocity = Protocol::PackedVelocity(Game::QuantizeVelocity(glm::vec3(1.f, 0.f, 0.f), 4.f));
+					auto p_orientation = Protocol::PackedQuat(Game::QuantizeOrientation(glm::identity<glm::quat>()));
+					p_players.push_back(Protocol::CreatePlayerDelta(message.builder, id, &p_position, &p_velocity, &p_orientation));
+				}
+				auto outPacket = Protocol::CreateWorldSnapshotS2CDirect(message.builder, tick, (uint32)tick + 1, 0, &p_players);
+				message.builder.Finish(Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_WorldSnapshotS2C, outPacket.Union()));
+				server.SendData(message, peer, Game::Channel::State);
+			}
+			server.Flush();
+		}
+		else
+		{
+			for (uint32 id = 0; id < numShips; id++)
+			{
+				Game::MessageBuilder message;
+				Protocol::QuantizedPlayer p_player(id, Protocol::QuantizedVec3((int16)(id + tick), (int16)id, (int16)tick),
+					Protocol::PackedVelocity(Game::QuantizeVelocity(glm::vec3(1.f, 0.f, 0.f), 4.f)),
+					Protocol::PackedQuat(Game::QuantizeOrientation(glm::identity<glm::quat>())));
+				auto outPacket = Protocol::CreateUpdatePlayerS2C(message.builder, tick, &p_player);
+				message.builder.Finish(Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_UpdatePlayerS2C, outPacket.Union()));
+				server.BroadcastData(message, Game::Channel::State);
+				server.Flush();
+			}
+		}
+		sendTime += Clock::now() - start;
+
+		connection.Update();
+	}
+	Game::SendCounters after = server.GetSendCounters();
+
+	// ENet sends each datagram with one sendmsg call
+	uint64 packets = after.packets - before.packets;
+	uint64 datagrams = after.datagrams - before.datagrams;
+	uint64 bytes = after.bytes - before.bytes;
+	std::printf("snapshots %s: %zu clients, %.1f packets, %.1f datagrams (send calls) and %.0f bytes per tick, %.3f ms per tick sending\n",
+		batched ? "batched " : "per ship", server.connectedPeers.size(), (double)packets / (double)numTicks, (double)datagrams / (double)numTicks,
+		(double)bytes / (double)numTicks, Seconds(sendTime) * 1000.0 / (double)numTicks);
+	return true;
+}
+
+int
+main(int argc, const char** argv)
+{
+	enet_uint16 port = argc > 1 ? (enet_uint16)std::atoi(argv[1]) : 12360;
+
+	// the same as Game::InitializeENet, but with ENet's allocations counted
+	ENetCallbacks callbacks = { CountedMalloc, std::free, nullptr };
+	if (enet_initialize_with_callbacks(ENET_VERSION, &callbacks) != 0)
+	{
+		std::printf("failed to initialize ENet\n");
+		return 1;
+	}
+	atexit(enet_deinitialize);
+
+	bool ok = BenchReceive(port);
+	ok = BenchFlush(port + 1, true) && ok;
+	ok = BenchFlush(port + 2, false) && ok;
+	ok = BenchAllocations(port + 3, false) && ok;
+	ok = BenchAllocations(port + 4, true) && ok;
+	ok = BenchSnapshots(port + 5, false) && ok;
+	ok = BenchSnapshots(port + 6, true) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "config.h"
+#include "game/shipintegrate.h"
+#include "game/spaceship.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// IntegrateShips against IntegrateShipsScalar, usage: bench_ships [--check]. --check only compares the two
+
+typedef std::chrono::steady_clock Clock;
+
+static const float tickDelta = 1.f / 60.f;
+
+// ships spread over the world in every state a tick can leave them in, some turning faster than the wide path takes
+static void FillStore(Game::ShipStore& ships, size_t count, uint32 seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	ships.Clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 position(unit(rng) * 1000.f, unit(rng) * 1000.f, unit(rng) * 1000.f);
+		glm::quat orientation = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+		ships.Add((uint32)i, (uint32)i, position, orientation);
+
+		ships.velocities[i] = glm::vec3(unit(rng), unit(rng), unit(rng)) * Game::SpaceShip::boostSpeed;
+		ships.speeds[i] = (unit(rng) + 1.f) * Game::SpaceShip::normalSpeed;
+		ships.turnRates[i] = glm::vec3(unit(rng), unit(rng), unit(rng)) * (i % 97 == 0 ? 4.f : 0.03f);
+		ships.rolls[i] = unit(rng) * 45.f;
+		ships.inputs[i] = (uint16)(rng() & 0x1ff);
+	}
+}
+
+// the largest difference one tick makes between the two paths, starting from the same ships every tick
+static bool CheckEquivalence()
+{
+	Game::ShipStore wide;
+	Game::ShipStore scalar;
+	FillStore(scalar, 4096 + 3, 1);// and a few that don't fill a block
+
+	std::mt19937 rng(2);
+	float maxPosition = 0.f;
+	float maxVelocity = 0.f;
+	float maxOrientation = 0.f;
+	for (int tick = 0; tick < 600; tick++)
+	{
+		if (tick % 30 == 0)
+		{
+			for (size_t i = 0; i < scalar.Size(); i++)
+				scalar.inputs[i] = (uint16)(rng() & 0x1ff);
+		}
+
+		wide = scalar;
+		Game::IntegrateShips(wide, tickDelta);
+		Game::IntegrateShipsScalar(scalar, tickDelta);
+
+		for (size_t i = 0; i < scalar.Size(); i++)
+		{
+			glm::quat a = wide.orientations[i];
+			glm::quat b = scalar.orientations[i];
+			maxPosition = glm::max(maxPosition, glm::distance(wide.positions[i], scalar.positions[i]));
+			maxVelocity = glm::max(maxVelocity, glm::distance(wide.velocities[i], scalar.velocities[i]));
+			maxOrientation = glm::max(maxOrientation, glm::length(glm::vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w)));
+		}
+	}
+
+	bool ok = maxPosition <= Game::shipIntegrateTolerance && maxVelocity <= Game::shipIntegrateTolerance && maxOrientation <= Game::shipIntegrateTolerance;
+	std::printf("equivalence: largest difference after a tick, position %g velocity %g orientation %g, tolerance %g: %s\n",
+		maxPosition, maxVelocity, maxOrientation, Game::shipIntegrateTolerance, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+template<typename Integrate>
+static double NanosecondsPerShip(Game::ShipStore& ships, Integrate integrate)
+{
+	const int numTicks = 2000;
+	auto start = Clock::now();
+	for (int tick = 0; tick < numTicks; tick++)
+		integrate(ships, tickDelta);
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return seconds * 1e9 / (double)numTicks / (double)ships.Size();
+}
+
+static void BenchIntegrate()
+{
+	for (size_t count : { 64, 512, 4096 })
+	{
+		Game::ShipStore ships;
+		FillStore(ships, count, 3);
+		double scalar = NanosecondsPerShip(ships, Game::IntegrateShipsScalar);
+		FillStore(ships, count, 3);
+		double wide = NanosecondsPerShip(ships, Game::IntegrateShips);
+		std::printf("integrate %4zu ships: scalar %6.1f ns per ship, wide %6.1f ns per ship, %.1fx\n", count, scalar, wide, scalar / wide);
+	}
+}
+
+int
+main(int argc, const char** argv)
+{
+	bool checkOnly = argc > 1 && std::strcmp(argv[1], "--check") == 0;
+
+	bool ok = CheckEquivalence();
+	if (!checkOnly)
+		BenchIntegrate();
+
+	return ok ? 0 : 1;
+}
@@ -8,18 +8,47 @@
 #include "render/debugrender.h"
 #include "render/input/inputserver.h"
 #include "core/random.h"
+#include "core/cvar.h"
+#include "game/shipintegrate.h"
 #include <chrono>
 
+// which kind of traffic each message sent to the server is
+static Game::Channel ChannelOf(Protocol::PacketType packetType)
+{
+    switch (packetType)
+    {
+    // sent every frame, the next input replaces a lost one
+    case Protocol::PacketType_InputC2S:
+        return Game::Channel::State;
+    default:
+        return Game::Channel::Bulk;
+    }
+}
+
+static Core::CVar* cl_netthread = nullptr;
+static Core::CVar* cl_predict = nullptr;
+static Core::CVar* cl_predictsmooth = nullptr;
+static Core::CVar* cl_predictsnap = nullptr;
+static Core::CVar* cl_interpolate = nullptr;
+
 ClientApp::ClientApp() :
     window(nullptr),
     console(nullptr),
     client(nullptr),
     currentTimeMillis(0),
     timeDiffMillis(0),
+    latestSnapshotSequence(0),
+    latestSnapshotTime(0),
+    latestSnapshotArrival(0),
+    snapshotAck(0),
     hasReceivedSpaceShip(false),
     controlledShipId(0),
     controlledShip(nullptr),
+    controlledShipRender(nullptr),
     spaceShipModel(0),
+    predicting(false),
+    tickDelta(0.f),
+    predictionAccumulator(0.f),
     laserModel(0),
     laserSpeed(0.f)
 {}
@@ -56,6 +85,12 @@ bool ClientApp::Open()
     if (!Game::InitializeENet())
         return false;
 
+    cl_netthread = Core::CVarCreate(Core::CVar_Int, "cl_netthread", "0", "1 to service the network on a thread of its own instead of once per frame");
+    cl_predict = Core::CVarCreate(Core::CVar_Int, "cl_predict", "1", "1 to move the controlled ship on local input right away instead of waiting for the server");
+    cl_predictsmooth = Core::CVarCreate(Core::CVar_Float, "cl_predictsmooth", "10", "how fast corrections of the predicted ship are eased out, per second");
+    cl_predictsnap = Core::CVarCreate(Core::CVar_Float, "cl_predictsnap", "4", "corrections of the predicted ship larger than this distance are not eased out");
+    cl_interpolate = Core::CVarCreate(Core::CVar_Int, "cl_interpolate", "1", "1 to draw newly spawned remote ships from buffered snapshots (SnapshotInterpolator), 0 to dead reckon them; per ship with the interpolate command");
+
     // setup console commands
     this->console = new Game::Console("console", 128, 128, 10);
     this->console->SetCommand("client", [this](const std::string& arg)
@@ -87,6 +122,12 @@ bool ClientApp::Open()
         }
         else
         {
+            // keeps acks and resends going while a frame is being rendered
+            if (Core::CVarReadInt(cl_netthread) != 0)
+                this->client->StartNetworkThread();
+
+            this->client->GetStats().SetMessageTypeNames(Protocol::EnumNamesPacketType());
+            this->console->SetNetStats(&this->client->GetStats());
             this->console->AddOutput("[INFO] client created, waiting for server...");
         }
     });
@@ -95,14 +136,33 @@ bool ClientApp::Open()
         if (this->client == nullptr || this->client->server == nullptr)
             return;
 
-        flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-        auto outPacket = Protocol::CreateTextC2SDirect(builder, arg.c_str());
-        auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_TextC2S, outPacket.Union());
-        builder.Finish(packetWrapper);
+        Game::MessageBuilder message;
+        auto outPacket = Protocol::CreateTextC2SDirect(message.builder, arg.c_str());
+        auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_TextC2S, outPacket.Union());
+        message.builder.Finish(packetWrapper);
 
-        this->client->SendData(builder.GetBufferPointer(), builder.GetSize(), this->client->server, ENET_PACKET_FLAG_RELIABLE);
+        this->client->SendData(message, this->client->server, ChannelOf(Protocol::PacketType_TextC2S));
         this->console->AddOutput("[MESSAGE] you: " + arg);
     });
+    this->console->SetCommand("interpolate", [this](const std::string& arg)
+    {
+        // "<ship id> <0|1>", or "all <0|1>"
+        char target[32];
+        int enable;
+        if (sscanf(arg.c_str(), "%31s %d", target, &enable) != 2)
+        {
+            this->console->AddOutput("[ERROR] usage: interpolate <ship id|all> <0|1>");
+            return;
+        }
+
+        bool all = strcmp(target, "all") == 0;
+        uint32 id = (uint32)strtoul(target, nullptr, 10);
+        for (Game::SpaceShip* spaceShip : this->spaceShips)
+        {
+            if (all || spaceShip->id == id)
+                spaceShip->interpolate = enable != 0;
+        }
+    });
 
     // setup space ships and lasers
     this->spaceShipModel = Render::LoadModel("assets/space/spaceship.glb");
@@ -224,7 +284,7 @@ void ClientApp::Run()
 
         if (this->controlledShip != nullptr)
         {
-            this->controlledShip->FollowThisWithCamera(dt);
+            this->controlledShipRender->FollowWithCamera(*this->controlledShip, dt);
         }
         else
         {
@@ -251,7 +311,7 @@ void ClientApp::Run()
         // transfer new frame to window
         this->window->SwapBuffers();
 
-        this->UpdateNetwork();
+        this->UpdateNetwork((float)dt);
 
         auto timeEnd = std::chrono::steady_clock::now();
         dt = std::min(0.04, std::chrono::duration<double>(timeEnd - timeStart).count());
@@ -279,20 +339,28 @@ void ClientApp::OnServerDisconnect()
     this->console->AddOutput("[INFO] server disconnected");
 
     // remove other ships
-    for (auto& spaceShip : this->spaceShips)
-        if (spaceShip != this->controlledShip)
-            delete spaceShip;
+    for (size_t i = 0; i < this->spaceShips.size(); i++)
+    {
+        if (this->spaceShips[i] != this->controlledShip)
+        {
+            delete this->spaceShips[i];
+            delete this->spaceShipRenders[i];
+        }
+    }
     
     this->spaceShips.clear();
+    this->spaceShipRenders.clear();
 
     if (this->controlledShip != nullptr)
+    {
         this->spaceShips.push_back(this->controlledShip);
+        this->spaceShipRenders.push_back(this->controlledShipRender);
+    }
 
-    // remove lasers
-    for (auto& laser : this->lasers)
-        delete laser;
+    this->playoutClock.Reset();
 
-    this->lasers.clear();
+    // remove lasers
+    this->lasers.Clear();
 }
 
 
@@ -317,28 +385,19 @@ void ClientApp::RenderUI()
     }
 }
 
-void ClientApp::UpdateNetwork()
+void ClientApp::UpdateNetwork(float deltaTime)
 {
     if (this->client == nullptr || this->client->server == nullptr)
         return;
 
-    // get input data and send it to server
-    unsigned short inputData = this->CompressInputData(this->GetInputData());
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    auto outPacket = Protocol::CreateInputC2S(builder, this->currentTimeMillis, inputData);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_InputC2S, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->client->SendData(builder.GetBufferPointer(), builder.GetSize(), this->client->server, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
-
-
     // read data from server
     this->client->Update();
 
     Game::Data d;
-    while (this->client->PopDataStack(d))
+    while (this->client->PopData(d))
     {
         // TODO: parse incomming data and call the correct functions on that data
-        auto packet = Protocol::GetPacketWrapper(&d.data->front());
+        auto packet = Protocol::GetPacketWrapper(d.GetData());
         Protocol::PacketType packetType = packet->packet_type();
         switch (packetType)
         {
@@ -357,6 +416,9 @@ void ClientApp::UpdateNetwork()
         case Protocol::PacketType::PacketType_UpdatePlayerS2C:
             this->HandleMessage_UpdatePlayer(packet);
             break;
+        case Protocol::PacketType::PacketType_WorldSnapshotS2C:
+            this->HandleMessage_WorldSnapshot(packet);
+            break;
         case Protocol::PacketType::PacketType_TeleportPlayerS2C:
             this->HandleMessage_TeleportPlayer(packet);
             break;
@@ -371,6 +433,64 @@ void ClientApp::UpdateNetwork()
             break;
         }
     }
+
+    this->client->ReleaseReceivedData();
+
+    // the server may have disconnected us while receiving
+    if (this->client->server == nullptr)
+        return;
+
+    // send input after receiving, so that it acknowledges the newest snapshot
+    bool wasPredicting = this->predicting;
+    this->predicting = this->IsPredicting();
+    if (!this->predicting)
+    {
+        this->SendInput(this->CompressInputData(this->GetInputData()), 0);
+        this->client->Flush();
+        return;
+    }
+
+    // start from the newest state the server sent
+    if (!wasPredicting)
+    {
+        const Game::DeadRecBody::Body& body = this->controlledShip->drBody.serverAtT0;
+        Game::SpaceShipState state = Game::SpaceShipState::Capture(*this->controlledShip);
+        state.position = body.position;
+        state.linearVelocity = body.velocity;
+        state.orientation = body.orientation;
+        state.Apply(*this->controlledShip);
+        this->predictor.Reset();
+        this->predictionAccumulator = 0.f;
+    }
+
+    // the ship moves in the server's ticks, one input is sent for each
+    this->predictionAccumulator = std::min(this->predictionAccumulator + deltaTime, this->tickDelta * 8.f);
+    while (this->predictionAccumulator >= this->tickDelta)
+    {
+        Game::InputData input = this->GetInputData();
+        uint32 sequence = this->predictor.Predict(*this->controlledShip, input, this->tickDelta);
+        this->SendInput(this->CompressInputData(input), sequence);
+        this->predictionAccumulator -= this->tickDelta;
+    }
+    this->client->Flush();
+
+    this->predictor.Smooth(*this->controlledShip, deltaTime, Core::CVarReadFloat(cl_predictsmooth));
+}
+
+void ClientApp::SendInput(uint16 inputData, uint32 sequence)
+{
+    // the other ships are dead reckoned from the newest snapshot, so they show the server's world that long after it
+    uint64 viewTime = this->latestSnapshotTime != 0 ? this->latestSnapshotTime + (this->currentTimeMillis - this->latestSnapshotArrival) : 0;
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateInputC2S(message.builder, this->currentTimeMillis, inputData, this->snapshotAck, viewTime, sequence);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_InputC2S, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->client->SendData(message, this->client->server, ChannelOf(Protocol::PacketType_InputC2S));
+}
+
+bool ClientApp::IsPredicting() const
+{
+    return this->controlledShip != nullptr && this->tickDelta > 0.f && Core::CVarReadInt(cl_predict) != 0;
 }
 
 void ClientApp::TryGetControlledSpaceShip()
@@ -380,29 +500,36 @@ void ClientApp::TryGetControlledSpaceShip()
 
     size_t index = this->SpaceShipIndex(this->controlledShipId);
     if (index < spaceShips.size())
+    {
         this->controlledShip = spaceShips[index];
+        this->controlledShipRender = spaceShipRenders[index];
+    }
 }
 
 void ClientApp::UpdateAndDrawSpaceShips(float deltaTime)
 {
+    double renderTime = this->playoutClock.GetRenderTime(this->currentTimeMillis);
     for (size_t i = 0; i < this->spaceShips.size(); i++)
     {
-        this->spaceShips[i]->ClientUpdate(deltaTime);
+        // the predicted ship is moved by UpdateNetwork instead
+        if (!this->predicting || this->spaceShips[i] != this->controlledShip)
+            this->spaceShips[i]->ClientUpdate(deltaTime, renderTime);
+        this->spaceShipRenders[i]->Update(*this->spaceShips[i]);
         Render::RenderDevice::Draw(this->spaceShipModel, this->spaceShips[i]->transform);
     }
 }
 
 void ClientApp::UpdateAndDrawLasers()
 {
-    for (int i = (int)this->lasers.size()-1; i>=0; i--)
+    for (int i = (int)this->lasers.Size()-1; i>=0; i--)
     {
-        if (this->lasers[i]->ShouldDespawn(this->currentTimeMillis))
+        if (this->lasers.ShouldDespawn(i, this->currentTimeMillis))
         {
-            this->DespawnLaserDirect(i);
+            this->lasers.Remove(i);
             continue;
         }
 
-        Render::RenderDevice::Draw(this->laserModel, this->lasers[i]->GetLocalToWorld(this->currentTimeMillis, this->laserSpeed));
+        Render::RenderDevice::Draw(this->laserModel, this->lasers.GetLocalToWorld(i, this->currentTimeMillis, this->laserSpeed));
     }
 }
 
@@ -435,12 +562,36 @@ void ClientApp::UnpackLaser(const Protocol::Laser* laser, glm::vec3& origin, glm
     orientation = glm::quat(p_dir.w(), p_dir.x(), p_dir.y(), p_dir.z());
 }
 
+void ClientApp::UnpackQuantizedPlayer(const Protocol::QuantizedPlayer* player, glm::vec3& position, glm::vec3& velocity, glm::quat& orientation, uint32& id)
+{
+    auto& p_pos = player->position();
+    id = player->uuid();
+
+    position = Game::DequantizePosition(glm::i16vec3(p_pos.x(), p_pos.y(), p_pos.z()), this->quantizationBounds.worldBound);
+    velocity = Game::DequantizeVelocity(player->velocity().bits(), this->quantizationBounds.maxSpeed);
+    orientation = Game::DequantizeOrientation(player->direction().bits());
+}
+
+void ClientApp::UnpackQuantizedLaser(const Protocol::QuantizedLaser* laser, glm::vec3& origin, glm::quat& orientation, uint64& spawnTime, uint64& despawnTime, uint32& id)
+{
+    auto& p_origin = laser->origin();
+    spawnTime = laser->start_time();
+    despawnTime = laser->end_time();
+    id = laser->uuid();
+
+    origin = Game::DequantizePosition(glm::i16vec3(p_origin.x(), p_origin.y(), p_origin.z()), this->quantizationBounds.worldBound);
+    orientation = Game::DequantizeOrientation(laser->direction().bits());
+}
+
 void ClientApp::HandleMessage_ClientConnect(const Protocol::PacketWrapper* packet)
 {
     const Protocol::ClientConnectS2C* inPacket = static_cast<const Protocol::ClientConnectS2C*>(packet->packet());
     this->controlledShipId = inPacket->uuid();
     uint64 serverTime = inPacket->time();
     this->timeDiffMillis = this->currentTimeMillis - serverTime;
+    this->quantizationBounds.worldBound = inPacket->world_bound();
+    this->quantizationBounds.maxSpeed = inPacket->max_speed();
+    this->tickDelta = inPacket->tick_rate() != 0 ? 1.f / (float)inPacket->tick_rate() : 0.f;
 
     this->hasReceivedSpaceShip = true;
 }
@@ -484,7 +635,7 @@ void ClientApp::HandleMessage_GameState(const Protocol::PacketWrapper* packet)
         this->UnpackLaser(p_laser, origin, orientation, spawnTime, despawnTime, id);
 
         // laser is new and must be spawned
-        if (this->LaserIndex(id) >= this->lasers.size())
+        if (this->lasers.Find(id) >= this->lasers.Size())
         {
             this->SpawnLaser(origin, orientation, 0, spawnTime, despawnTime, id);
         }
@@ -521,12 +672,89 @@ void ClientApp::HandleMessage_UpdatePlayer(const Protocol::PacketWrapper* packet
     auto p_player = inPacket->player();
     glm::vec3 position;
     glm::vec3 velocity;
-    glm::vec3 acceleration;
     glm::quat orientation;
     uint32 id;
-    this->UnpackPlayer(p_player, position, velocity, acceleration, orientation, id);
+    this->UnpackQuantizedPlayer(p_player, position, velocity, orientation, id);
+
+    this->UpdateSpaceShipData(position, velocity, glm::vec3(0.f), orientation, id, false, inPacket->time());
+}
+
+void ClientApp::HandleMessage_WorldSnapshot(const Protocol::PacketWrapper* packet)
+{
+    const Protocol::WorldSnapshotS2C* inPacket = static_cast<const Protocol::WorldSnapshotS2C*>(packet->packet());
+
+    // snapshots are unreliable and may arrive out of order, anything older than what we have is useless
+    if (inPacket->sequence() <= this->latestSnapshotSequence)
+        return;
+
+    Game::SnapshotPtr baseline = nullptr;
+    if (inPacket->baseline() != 0)
+    {
+        baseline = this->receivedSnapshots.Find(inPacket->baseline());
+        if (baseline == nullptr)
+        {
+            // the baseline has already left the ring, start over from a full snapshot
+            this->snapshotAck = 0;
+            return;
+        }
+    }
+
+    // rebuild the full snapshot from the baseline and the changed fields
+    auto snapshot = std::make_shared<Game::Snapshot>();
+    if (baseline != nullptr)
+        snapshot->entities = baseline->entities;
+    snapshot->sequence = inPacket->sequence();
+    snapshot->time = inPacket->time();
+    this->playoutClock.OnSnapshot(snapshot->time, this->currentTimeMillis);
+
+    auto p_players = inPacket->players();
+    for (size_t i = 0; i < p_players->size(); i++)
+    {
+        auto p_player = p_players->operator[](i);
+        Game::EntityState& state = snapshot->FindOrAdd(p_player->uuid());
+
+        if (auto p_pos = p_player->position())
+            state.position = glm::i16vec3(p_pos->x(), p_pos->y(), p_pos->z());
+        if (auto p_vel = p_player->velocity())
+            state.velocity = p_vel->bits();
+        if (auto p_dir = p_player->direction())
+            state.orientation = p_dir->bits();
+
+        glm::vec3 position = Game::DequantizePosition(state.position, this->quantizationBounds.worldBound);
+        glm::vec3 velocity = Game::DequantizeVelocity(state.velocity, this->quantizationBounds.maxSpeed);
+        glm::quat orientation = Game::DequantizeOrientation(state.orientation);
+        this->UpdateSpaceShipData(position, velocity, glm::vec3(0.f), orientation, state.id, false, snapshot->time);
+    }
+
+    // players that left the world since the baseline, the delta above only has the ones that are still in it
+    if (auto p_removed = inPacket->removed())
+    {
+        for (size_t i = 0; i < p_removed->size(); i++)
+        {
+            snapshot->Remove(p_removed->Get(i));
+            this->DespawnSpaceShip(p_removed->Get(i));
+        }
+    }
+
+    // the snapshot has our ship as the last input the server used left it, replay the ones it hasn't used yet
+    const Game::EntityState* ownState = snapshot->Find(this->controlledShipId);
+    if (this->predicting && ownState != nullptr && inPacket->input_ack() != 0)
+    {
+        // positions are rounded to the quantization step on each axis, and the server's wide integration drifts
+        // from our prediction by up to a tolerance each tick, allowed for over a second's worth of ticks
+        float tolerance = 2.f * this->quantizationBounds.worldBound / 32767.f + Game::shipIntegrateTolerance / this->tickDelta;
+        this->predictor.Reconcile(*this->controlledShip, inPacket->input_ack(),
+            Game::DequantizePosition(ownState->position, this->quantizationBounds.worldBound),
+            Game::DequantizeVelocity(ownState->velocity, this->quantizationBounds.maxSpeed),
+            Game::DequantizeOrientation(ownState->orientation),
+            this->tickDelta, tolerance, Core::CVarReadFloat(cl_predictsnap));
+    }
 
-    this->UpdateSpaceShipData(position, velocity, acceleration, orientation, id, false, inPacket->time());
+    this->receivedSnapshots.Store(snapshot);
+    this->latestSnapshotSequence = snapshot->sequence;
+    this->latestSnapshotTime = snapshot->time;
+    this->latestSnapshotArrival = this->currentTimeMillis;
+    this->snapshotAck = snapshot->sequence;
 }
 
 void ClientApp::HandleMessage_TeleportPlayer(const Protocol::PacketWrapper* packet)
@@ -535,12 +763,11 @@ void ClientApp::HandleMessage_TeleportPlayer(const Protocol::PacketWrapper* pack
     auto p_player = inPacket->player();
     glm::vec3 position;
     glm::vec3 velocity;
-    glm::vec3 acceleration;
     glm::quat orientation;
     uint32 id;
-    this->UnpackPlayer(p_player, position, velocity, acceleration, orientation, id);
+    this->UnpackQuantizedPlayer(p_player, position, velocity, orientation, id);
 
-    this->UpdateSpaceShipData(position, velocity, acceleration, orientation, id, true, inPacket->time());
+    this->UpdateSpaceShipData(position, velocity, glm::vec3(0.f), orientation, id, true, inPacket->time());
 }
 
 void ClientApp::HandleMessage_SpawnLaser(const Protocol::PacketWrapper* packet)
@@ -552,10 +779,10 @@ void ClientApp::HandleMessage_SpawnLaser(const Protocol::PacketWrapper* packet)
     uint64 spawnTime;
     uint64 despawnTime;
     uint32 id;
-    this->UnpackLaser(p_laser, origin, orientation, spawnTime, despawnTime, id);
+    this->UnpackQuantizedLaser(p_laser, origin, orientation, spawnTime, despawnTime, id);
 
     // laser is new and must be spawned
-    if (this->LaserIndex(id) >= this->lasers.size())
+    if (this->lasers.Find(id) >= this->lasers.Size())
     {
         this->SpawnLaser(origin, orientation, 0, spawnTime, despawnTime, id);
     }
@@ -580,8 +807,7 @@ void ClientApp::HandleMessage_Text(const Protocol::PacketWrapper* packet)
 
 unsigned short ClientApp::CompressInputData(const Game::InputData& data)
 {
-    return data.w | (data.a << 1) | (data.d << 2) | (data.up << 3) | (data.down << 4) |
-        (data.left << 5) | (data.right << 6) | (data.space << 7) | (data.shift << 8);
+    return data.ToBits();
 }
 
 Game::InputData ClientApp::GetInputData()
@@ -611,14 +837,6 @@ size_t ClientApp::SpaceShipIndex(uint32 spaceShipId)
     return index;
 }
 
-size_t ClientApp::LaserIndex(uint32 laserId)
-{
-    size_t index = 0;
-    for (; index < this->lasers.size() && this->lasers[index]->id != laserId; index++);
-
-    return index;
-}
-
 
 // -- operations in response to server messages
 
@@ -626,19 +844,33 @@ void ClientApp::SpawnSpaceShip(const glm::vec3& position, const glm::quat& orien
 {
     Game::SpaceShip* spaceShip = new Game::SpaceShip();
     spaceShip->id = spaceShipId;
+    spaceShip->interpolate = Core::CVarReadInt(cl_interpolate) != 0;
     spaceShip->position = position;
     this->spaceShips.push_back(spaceShip);
+    this->spaceShipRenders.push_back(new Game::SpaceShipRender());
 }
 
 void ClientApp::DespawnSpaceShip(uint32 spaceShipId)
 {
+    // whichever of the snapshot removal and the despawn message comes first, the other finds nothing left.
+    // the ship's lasers go with DespawnLaserS2C or their own timeout
+    this->receivedSnapshots.Evict(spaceShipId);
+
     size_t index = this->SpaceShipIndex(spaceShipId);
 
     if (index >= this->spaceShips.size())
         return;
 
+    if (this->spaceShips[index] == this->controlledShip)
+    {
+        this->controlledShip = nullptr;
+        this->controlledShipRender = nullptr;
+    }
+
     delete this->spaceShips[index];
+    delete this->spaceShipRenders[index];
     this->spaceShips.erase(this->spaceShips.begin() + index);
+    this->spaceShipRenders.erase(this->spaceShipRenders.begin() + index);
 }
 
 void ClientApp::UpdateSpaceShipData(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& acceleration, const glm::quat& orientation, uint32 spaceShipId, bool hardReset, uint64 timeStamp)
@@ -654,25 +886,16 @@ void ClientApp::UpdateSpaceShipData(const glm::vec3& position, const glm::vec3&
 
 void ClientApp::SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 spawnTimeMillis, uint64 despawnTimeMillis, uint32 laserId)
 {
-    Game::Laser* laser = new Game::Laser(origin, orientation, spaceShipId, spawnTimeMillis + this->timeDiffMillis, despawnTimeMillis + this->timeDiffMillis, laserId);
-    this->lasers.push_back(laser);
+    this->lasers.Add(laserId, spaceShipId, origin, orientation, spawnTimeMillis + this->timeDiffMillis, despawnTimeMillis + this->timeDiffMillis);
 }
 
 void ClientApp::DespawnLaser(uint32 laserId)
 {
-    size_t index = 0;
-    for (; index < this->lasers.size() && this->lasers[index]->id != laserId; index++);
+    size_t index = this->lasers.Find(laserId);
 
-    if (index >= this->lasers.size())
+    if (index >= this->lasers.Size())
         return;
 
-    delete this->lasers[index];
-    this->lasers.erase(this->lasers.begin() + index);
-}
-
-void ClientApp::DespawnLaserDirect(size_t laserIndex)
-{
-    delete this->lasers[laserIndex];
-    this->lasers.erase(this->lasers.begin() + laserIndex);
+    this->lasers.Remove(index);
 }
 
@@ -7,7 +7,11 @@
 #include "game/console.h"
 #include "game/network.h"
 #include "game/spaceship.h"
+#include "game/spaceship_render.h"
 #include "game/laser.h"
+#include "game/quantize.h"
+#include "game/snapshot.h"
+#include "game/prediction.h"
 #include <vector>
 #include "../build/generated/flat/proto.h"// include directory doesn't want to work in cmake :(
 
@@ -27,7 +31,9 @@ public:
 private:
 	// update functions
 	void RenderUI();
-	void UpdateNetwork();
+	void UpdateNetwork(float deltaTime);
+	void SendInput(uint16 inputData, uint32 sequence);
+	bool IsPredicting() const;
 	void TryGetControlledSpaceShip();
 	void UpdateAndDrawSpaceShips(float deltaTime);
 	void UpdateAndDrawLasers();
@@ -35,11 +41,14 @@ private:
 	// unpack messages from server
 	void UnpackPlayer(const Protocol::Player* player, glm::vec3& position, glm::vec3& velocity, glm::vec3& acceleration, glm::quat& orientation, uint32& id);
 	void UnpackLaser(const Protocol::Laser* laser, glm::vec3& origin, glm::quat& orientation, uint64& spawnTime, uint64& despawnTime, uint32& id);
+	void UnpackQuantizedPlayer(const Protocol::QuantizedPlayer* player, glm::vec3& position, glm::vec3& velocity, glm::quat& orientation, uint32& id);
+	void UnpackQuantizedLaser(const Protocol::QuantizedLaser* laser, glm::vec3& origin, glm::quat& orientation, uint64& spawnTime, uint64& despawnTime, uint32& id);
 	void HandleMessage_ClientConnect(const Protocol::PacketWrapper* packet);
 	void HandleMessage_GameState(const Protocol::PacketWrapper* packet);
 	void HandleMessage_SpawnPlayer(const Protocol::PacketWrapper* packet);
 	void HandleMessage_DespawnPlayer(const Protocol::PacketWrapper* packet);
 	void HandleMessage_UpdatePlayer(const Protocol::PacketWrapper* packet);
+	void HandleMessage_WorldSnapshot(const Protocol::PacketWrapper* packet);
 	void HandleMessage_TeleportPlayer(const Protocol::PacketWrapper* packet);
 	void HandleMessage_SpawnLaser(const Protocol::PacketWrapper* packet);
 	void HandleMessage_DespawnLaser(const Protocol::PacketWrapper* packet);
@@ -49,7 +58,6 @@ private:
 	unsigned short CompressInputData(const Game::InputData& data);
 	Game::InputData GetInputData();
 	size_t SpaceShipIndex(uint32 spaceShipId);
-	size_t LaserIndex(uint32 laserId);
 
 	// operations in response to server messages
 	void SpawnSpaceShip(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& velocity, uint32 spaceShipId);
@@ -57,23 +65,38 @@ private:
 	void UpdateSpaceShipData(const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& acceleration, const glm::quat& orientation, uint32 spaceShipId, bool hardReset, uint64 timeStamp);
 	void SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 spawnTimeMillis, uint64 despawnTimeMillis, uint32 laserId);
 	void DespawnLaser(uint32 laserId);
-	void DespawnLaserDirect(size_t laserIndex);
 
 	Display::Window* window;
 	Game::Console* console;
 	Game::Client* client;
 	uint64 currentTimeMillis;
 	uint64 timeDiffMillis;
+	Game::QuantizationBounds quantizationBounds;// received from the server on connect
+
+	Game::SnapshotRing receivedSnapshots;
+	uint32 latestSnapshotSequence;
+	uint64 latestSnapshotTime;// server time the newest snapshot was taken at
+	uint64 latestSnapshotArrival;// our time it arrived at
+	uint32 snapshotAck;// sent back with the input, 0 asks the server for a full snapshot
+	Game::PlayoutClock playoutClock;// when interpolated ships are drawn
 
 	std::vector<std::tuple<Render::ModelId, Physics::ColliderId, glm::mat4>> asteroids;
 
 	std::vector<Game::SpaceShip*> spaceShips;
+	std::vector<Game::SpaceShipRender*> spaceShipRenders;// same indexing as spaceShips
 	bool hasReceivedSpaceShip;
 	uint32 controlledShipId;
 	Game::SpaceShip* controlledShip;
+	Game::SpaceShipRender* controlledShipRender;
 	Render::ModelId spaceShipModel;
 
-	std::vector<Game::Laser*> lasers;
+	// the controlled ship runs ahead of the server on local input
+	Game::ShipPredictor predictor;
+	bool predicting;
+	float tickDelta;// the server's, received on connect
+	float predictionAccumulator;
+
+	Game::LaserStore lasers;
 	Render::ModelId laserModel;
 	float laserSpeed;
 };
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "config.h"
+#include "loadgen_app.h"
+#include "core/random.h"
+#include "core/cvar.h"
+#include "core/timing.h"
+#include <algorithm>
+#include <atomic>
+
+static std::atomic<bool> quitRequested(false);
+
+static Core::CVar* lg_address = nullptr;
+static Core::CVar* lg_bots = nullptr;
+static Core::CVar* lg_connectrate = nullptr;
+static Core::CVar* lg_inputrate = nullptr;
+static Core::CVar* lg_script = nullptr;
+static Core::CVar* lg_duration = nullptr;
+static Core::CVar* lg_report = nullptr;
+
+// the value below which the given fraction of the sorted values lie
+static float Percentile(const std::vector<float>& sortedValues, float fraction)
+{
+    if (sortedValues.empty())
+        return 0.f;
+
+    size_t index = (size_t)(fraction * (float)(sortedValues.size() - 1) + 0.5f);
+    return sortedValues[std::min(index, sortedValues.size() - 1)];
+}
+
+static uint64 TotalBytes(const Game::NetStats& stats, bool sent)
+{
+    uint64 bytes = 0;
+    for (size_t i = 0; i < Game::NetStats::maxMessageTypes; i++)
+    {
+        const Game::MessageTypeStats& type = stats.GetMessageTypeStats((uint8)i);
+        bytes += sent ? type.sent.bytes : type.received.bytes;
+    }
+    return bytes;
+}
+
+LoadGenApp::LoadGenApp() :
+    numConnectRequests(0),
+    currentTimeMillis(0),
+    numSnapshots(0),
+    bytesSentAtReport(0),
+    bytesReceivedAtReport(0)
+{}
+
+LoadGenApp::~LoadGenApp() {}
+
+bool LoadGenApp::Open()
+{
+    App::Open();
+
+    lg_address = Core::CVarCreate(Core::CVar_String, "lg_address", "127.0.0.1", "address of the server the bots connect to");
+    lg_bots = Core::CVarCreate(Core::CVar_Int, "lg_bots", "32", "number of simulated players");
+    lg_connectrate = Core::CVarCreate(Core::CVar_Int, "lg_connectrate", "50", "bots that start connecting per second, so that the server isn't hit by all of them at once");
+    lg_inputrate = Core::CVarCreate(Core::CVar_Int, "lg_inputrate", "60", "inputs each bot sends per second");
+    lg_script = Core::CVarCreate(Core::CVar_String, "lg_script", "", "file with one \"<seconds> <input bitmap>\" step per line, random input if empty");
+    lg_duration = Core::CVarCreate(Core::CVar_Float, "lg_duration", "0", "seconds before the bots disconnect, 0 to run until interrupted");
+    lg_report = Core::CVarCreate(Core::CVar_Float, "lg_report", "5", "seconds between reports");
+
+    if (!Game::InitializeENet())
+        return false;
+
+    const char* scriptPath = Core::CVarReadString(lg_script);
+    if (scriptPath[0] != '\0' && !this->LoadScript(scriptPath))
+        return false;
+
+    this->address = Core::CVarReadString(lg_address);
+    this->bots.resize((size_t)std::max(1, Core::CVarReadInt(lg_bots)));
+    printf("[INFO] %zu bots connecting to %s, %s input\n", this->bots.size(), this->address.c_str(),
+        this->script.empty() ? "random" : "scripted");
+    return true;
+}
+
+void LoadGenApp::Run()
+{
+    // the bots are serviced far more often than they send, so that replies are timed accurately
+    const auto frameDelta = std::chrono::milliseconds(2);
+    auto startTime = std::chrono::steady_clock::now();
+    this->lastReport = startTime;
+
+    while (!quitRequested)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        double time = std::chrono::duration<double>(frameStart - startTime).count();
+        this->currentTimeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        float duration = Core::CVarReadFloat(lg_duration);
+        if (duration > 0.f && time >= (double)duration)
+            break;
+
+        // ramp up the connections
+        size_t numDue = std::min(this->bots.size(), (size_t)(time * (double)std::max(1, Core::CVarReadInt(lg_connectrate))) + 1);
+        while (this->numConnectRequests < numDue)
+            this->ConnectBot(this->numConnectRequests++);
+
+        for (Bot& bot : this->bots)
+            this->UpdateBot(bot, time);
+
+        float reportInterval = std::max(0.1f, Core::CVarReadFloat(lg_report));
+        if (std::chrono::duration<float>(frameStart - this->lastReport).count() >= reportInterval)
+            this->Report(time);
+
+        Core::SleepUntil(frameStart + frameDelta);
+    }
+
+    this->Report(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+}
+
+void LoadGenApp::Exit()
+{
+    for (Bot& bot : this->bots)
+        delete bot.client;
+
+    this->bots.clear();
+}
+
+void LoadGenApp::RequestQuit()
+{
+    quitRequested = true;
+}
+
+bool LoadGenApp::LoadScript(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        printf("[ERROR] failed to open input script %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) != nullptr)
+    {
+        if (line[0] == '#')
+            continue;
+
+        double duration;
+        unsigned int bitmap;
+        if (sscanf(line, "%lf %u", &duration, &bitmap) == 2 && duration > 0.0)
+            this->script.push_back({ duration, (uint16)bitmap });
+    }
+    fclose(file);
+
+    if (this->script.empty())
+    {
+        printf("[ERROR] input script %s has no steps\n", path);
+        return false;
+    }
+    return true;
+}
+
+void LoadGenApp::ConnectBot(size_t index)
+{
+    Bot& bot = this->bots[index];
+    bot.client = new Game::Client();
+
+    auto connected = [&bot](ENetPeer* server)
+    {
+        bot.connected = true;
+    };
+
+    auto disconnected = [&bot](ENetPeer* server)
+    {
+        bot.connected = false;
+        bot.snapshotAck = 0;
+    };
+
+    if (!bot.client->Initialize(connected, disconnected) ||
+        !bot.client->RequestConnectionToServer(this->address.c_str(), 1234))
+    {
+        delete bot.client;
+        bot.client = nullptr;
+        return;
+    }
+
+    // bots start at different points of the script, so that they don't move in lockstep
+    if (!this->script.empty())
+        bot.scriptIndex = index % this->script.size();
+}
+
+void LoadGenApp::UpdateBot(Bot& bot, double time)
+{
+    if (bot.client == nullptr)
+        return;
+
+    bot.client->Update();
+
+    Game::Data d;
+    while (bot.client->PopData(d))
+    {
+        auto packet = Protocol::GetPacketWrapper(d.GetData());
+        if (packet->packet_type() == Protocol::PacketType_WorldSnapshotS2C)
+            this->HandleMessage_WorldSnapshot(bot, packet);
+    }
+    bot.client->ReleaseReceivedData();
+
+    if (!bot.connected || bot.client->server == nullptr || time < bot.nextInputTime)
+        return;
+
+    if (time >= bot.nextBitmapTime)
+    {
+        double stepDuration;
+        bot.bitmap = this->NextBitmap(bot, stepDuration);
+        bot.nextBitmapTime = time + stepDuration;
+    }
+
+    // acknowledges the newest snapshot, like a client that decoded it
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateInputC2S(message.builder, this->currentTimeMillis, bot.bitmap, bot.snapshotAck);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_InputC2S, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    bot.client->SendData(message, bot.client->server, Game::Channel::State);
+    bot.client->Flush();
+
+    // the first input is jittered, so that the bots' inputs are spread over the interval
+    double inputInterval = 1.0 / (double)std::max(1, Core::CVarReadInt(lg_inputrate));
+    if (bot.nextInputTime == 0.0)
+        bot.nextInputTime = time + inputInterval * (double)Core::RandomFloat();
+    else
+        bot.nextInputTime = std::max(bot.nextInputTime + inputInterval, time);
+}
+
+void LoadGenApp::HandleMessage_WorldSnapshot(Bot& bot, const Protocol::PacketWrapper* packet)
+{
+    const Protocol::WorldSnapshotS2C* inPacket = static_cast<const Protocol::WorldSnapshotS2C*>(packet->packet());
+
+    bot.snapshotAck = std::max(bot.snapshotAck, inPacket->sequence());
+    this->tickTimes.push_back(inPacket->tick_time());
+    this->numSnapshots++;
+}
+
+uint16 LoadGenApp::NextBitmap(Bot& bot, double& outDuration)
+{
+    if (!this->script.empty())
+    {
+        const ScriptStep& step = this->script[bot.scriptIndex];
+        bot.scriptIndex = (bot.scriptIndex + 1) % this->script.size();
+        outDuration = step.duration;
+        return step.bitmap;
+    }
+
+    // hold a random mix of thrust, turning and firing for a while
+    uint16 bitmap = (uint16)(Core::FastRandom() & 127);
+    if (Core::RandomFloat() < 0.3f)
+        bitmap |= 128;// space
+    if (Core::RandomFloat() < 0.1f)
+        bitmap |= 256;// shift
+    outDuration = 0.2 + 1.8 * (double)Core::RandomFloat();
+    return bitmap;
+}
+
+void LoadGenApp::Report(double time)
+{
+    auto now = std::chrono::steady_clock::now();
+    float seconds = std::max(0.001f, std::chrono::duration<float>(now - this->lastReport).count());
+    this->lastReport = now;
+
+    size_t numConnected = 0;
+    uint64 bytesSent = 0;
+    uint64 bytesReceived = 0;
+    std::vector<float> roundTripTimes;
+    std::vector<float> downstreamRates;
+    for (Bot& bot : this->bots)
+    {
+        if (bot.client == nullptr)
+            continue;
+
+        const Game::NetStats& stats = bot.client->GetStats();
+        uint64 botReceived = TotalBytes(stats, false);
+        bytesSent += TotalBytes(stats, true);
+        bytesReceived += botReceived;
+
+        if (bot.connected)
+        {
+            numConnected++;
+            for (const Game::PeerStats& peer : stats.GetPeerStats())
+                roundTripTimes.push_back((float)peer.roundTripTime);
+            downstreamRates.push_back((float)(botReceived - bot.bytesReceivedAtReport) / seconds);
+        }
+        bot.bytesReceivedAtReport = botReceived;
+    }
+
+    std::sort(roundTripTimes.begin(), roundTripTimes.end());
+    std::sort(downstreamRates.begin(), downstreamRates.end());
+    std::sort(this->tickTimes.begin(), this->tickTimes.end());
+
+    float upRate = (float)(bytesSent - this->bytesSentAtReport) / seconds;
+    float downRate = (float)(bytesReceived - this->bytesReceivedAtReport) / seconds;
+    this->bytesSentAtReport = bytesSent;
+    this->bytesReceivedAtReport = bytesReceived;
+
+    printf("[REPORT] t=%.0fs bots %zu/%zu connected, %.1f snapshots/s per bot\n", time, numConnected, this->bots.size(),
+        numConnected > 0 ? (float)this->numSnapshots / seconds / (float)numConnected : 0.f);
+    printf("  server tick ms   p50 %6.2f  p99 %6.2f  max %6.2f\n",
+        Percentile(this->tickTimes, 0.5f), Percentile(this->tickTimes, 0.99f), Percentile(this->tickTimes, 1.f));
+    printf("  rtt ms           p50 %6.0f  p90 %6.0f  p99 %6.0f  max %6.0f\n",
+        Percentile(roundTripTimes, 0.5f), Percentile(roundTripTimes, 0.9f), Percentile(roundTripTimes, 0.99f), Percentile(roundTripTimes, 1.f));
+    printf("  down kB/s/bot    p50 %6.2f  p99 %6.2f  max %6.2f\n",
+        Percentile(downstreamRates, 0.5f) * 0.001f, Percentile(downstreamRates, 0.99f) * 0.001f, Percentile(downstreamRates, 1.f) * 0.001f);
+    printf("  total kB/s       down %8.1f  up %8.1f\n", downRate * 0.001f, upRate * 0.001f);
+    fflush(stdout);
+
+    this->tickTimes.clear();
+    this->numSnapshots = 0;
+}
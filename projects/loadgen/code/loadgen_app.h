@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/app.h"
+#include "game/network.h"
+#include <vector>
+#include <string>
+#include <chrono>
+#include "../build/generated/flat/proto.h"// include directory doesn't want to work in cmake :(
+
+// one simulated player, with a connection of its own
+struct Bot
+{
+	Game::Client* client = nullptr;
+	bool connected = false;
+	uint32 snapshotAck = 0;
+	uint16 bitmap = 0;
+	double nextInputTime = 0.0;// seconds since the start
+	double nextBitmapTime = 0.0;
+	size_t scriptIndex = 0;
+	uint64 bytesReceivedAtReport = 0;
+};
+
+// a step of scripted input, repeated from the start when the script ends
+struct ScriptStep
+{
+	double duration;// seconds
+	uint16 bitmap;
+};
+
+// connects many headless clients to a server and reports how it copes
+class LoadGenApp : public Core::App
+{
+public:
+	LoadGenApp();
+	~LoadGenApp();
+
+	bool Open();
+	void Run();
+	void Exit();
+
+	// stops the bots, safe to call from a signal handler
+	static void RequestQuit();
+
+private:
+	bool LoadScript(const char* path);
+	void ConnectBot(size_t index);
+	void UpdateBot(Bot& bot, double time);
+	void HandleMessage_WorldSnapshot(Bot& bot, const Protocol::PacketWrapper* packet);
+	uint16 NextBitmap(Bot& bot, double& outDuration);
+	void Report(double time);
+
+	std::vector<Bot> bots;
+	std::vector<ScriptStep> script;
+	std::string address;
+	size_t numConnectRequests;
+	uint64 currentTimeMillis;
+
+	// collected since the last report
+	std::chrono::steady_clock::time_point lastReport;
+	std::vector<float> tickTimes;// reported by the server in its snapshots
+	uint64 numSnapshots;
+	uint64 bytesSentAtReport;
+	uint64 bytesReceivedAtReport;
+};
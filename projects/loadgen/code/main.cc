@@ -0,0 +1,25 @@
+#include "config.h"
+#include "loadgen_app.h"
+#include "core/cvar.h"
+#include <csignal>
+
+int
+main(int argc, const char** argv)
+{
+	// usage: loadgen [address] [bots]
+	if (argc > 1)
+		Core::CVarWriteString(Core::CVarCreate(Core::CVar_String, "lg_address", "127.0.0.1"), argv[1]);
+	if (argc > 2)
+		Core::CVarParseWrite(Core::CVarCreate(Core::CVar_Int, "lg_bots", "32"), argv[2]);
+
+	std::signal(SIGINT, [](int) { LoadGenApp::RequestQuit(); });
+	std::signal(SIGTERM, [](int) { LoadGenApp::RequestQuit(); });
+
+	LoadGenApp app;
+	if (app.Open())
+	{
+		app.Run();
+		app.Close();
+	}
+	app.Exit();
+}
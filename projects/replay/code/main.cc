@@ -0,0 +1,46 @@
+#include "config.h"
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+
+static void Print(const char* name, const ReplayResult& result)
+{
+	std::printf("%-16s mean error %7.3f  max error %7.3f  mean delay %7.1f ms  snaps %u of %u frames\n",
+		name, result.meanError, result.maxError, result.meanDelay, result.numSnaps, result.numFrames);
+}
+
+int
+main(int argc, const char** argv)
+{
+	// usage: replay [trace], or replay --write trace to save the built in trace
+	Trace trace;
+	if (argc > 2 && std::strcmp(argv[1], "--write") == 0)
+	{
+		trace = GenerateTrace(1, 30.f);
+		if (!SaveTrace(argv[2], trace))
+		{
+			std::printf("[ERROR] failed to write %s\n", argv[2]);
+			return 1;
+		}
+	}
+	else if (argc > 1)
+	{
+		if (!LoadTrace(argv[1], trace))
+		{
+			std::printf("[ERROR] failed to load %s\n", argv[1]);
+			return 1;
+		}
+	}
+	else
+	{
+		trace = GenerateTrace(1, 30.f);
+	}
+
+	ReplayResult deadReckoning = Replay(trace, false);
+	ReplayResult interpolation = Replay(trace, true);
+	Print("dead reckoning", deadReckoning);
+	Print("interpolation", interpolation);
+
+	// the interpolator is only worth switching to if it draws the ship closer to where it was
+	return interpolation.meanError < deadReckoning.meanError ? 0 : 1;
+}
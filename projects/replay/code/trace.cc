@@ -0,0 +1,233 @@
+#include "config.h"
+#include "trace.h"
+#include "game/spaceship.h"
+#include "game/quantize.h"
+#include <algorithm>
+#include <cstdio>
+
+static const uint32 tickRate = 60;
+static const uint32 ticksPerSnapshot = 3;
+static const uint64 clockOffset = 5000;// client clock minus server clock
+static const float latency = 60.f;// milliseconds
+static const float jitter = 20.f;// either way
+static const float lossPercent = 3.f;
+static const float reorderPercent = 3.f;
+static const float reorderDelay = 40.f;
+static const uint64 warmupMillis = 1000;// left out of the measurements, until the playout clock has settled
+static const uint64 frameRate = 120;
+
+// xorshift32, so that a trace is the same on every platform
+static float RandomFloat(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (float)(state >> 8) / 16777216.f;
+}
+
+Trace GenerateTrace(uint32 seed, float seconds)
+{
+	uint32 state = seed != 0 ? seed : 1;
+	Trace trace;
+
+	glm::vec3 position(0.f);
+	glm::quat orientation = glm::identity<glm::quat>();
+	glm::vec3 linearVelocity(0.f);
+	float currentSpeed = 0.f;
+	glm::vec3 rotationSmooth(0.f);
+	float rotationZ = 0.f;
+
+	uint16 input = 0;
+	float inputTimeLeft = 0.f;
+	const float dt = 1.f / (float)tickRate;
+	uint32 numTicks = (uint32)(seconds * (float)tickRate);
+
+	for (uint32 tick = 0; tick < numTicks; tick++)
+	{
+		// mostly flying forwards, turning and rolling on and off
+		if (inputTimeLeft <= 0.f)
+		{
+			input = (uint16)((uint32)(RandomFloat(state) * 128.f) & ~Game::InputBit_W);
+			if (RandomFloat(state) < 0.8f)
+				input |= Game::InputBit_W;
+			if (RandomFloat(state) < 0.3f)
+				input |= Game::InputBit_Shift;
+			inputTimeLeft = 0.5f + 1.5f * RandomFloat(state);
+		}
+		inputTimeLeft -= dt;
+
+		Game::IntegrateShip(input, dt, position, orientation, linearVelocity, currentSpeed, rotationSmooth, rotationZ);
+
+		TraceEntry entry;
+		entry.serverTime = (uint64)tick * 1000 / tickRate;
+		entry.arrival = -1;
+		entry.position = position;
+		entry.velocity = linearVelocity;
+		entry.orientation = orientation;
+
+		if (tick % ticksPerSnapshot == 0 && RandomFloat(state) * 100.f >= lossPercent)
+		{
+			float delay = latency + (RandomFloat(state) * 2.f - 1.f) * jitter;
+			if (RandomFloat(state) * 100.f < reorderPercent)
+				delay += reorderDelay;
+			entry.arrival = (int64)(entry.serverTime + clockOffset + (uint64)delay);
+		}
+
+		trace.push_back(entry);
+	}
+
+	return trace;
+}
+
+bool LoadTrace(const char* path, Trace& outTrace)
+{
+	FILE* file = std::fopen(path, "r");
+	if (file == nullptr)
+		return false;
+
+	outTrace.clear();
+	char line[512];
+	while (std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		TraceEntry entry;
+		unsigned long long serverTime;
+		long long arrival;
+		glm::quat& q = entry.orientation;
+		if (std::sscanf(line, "%llu %lld %f %f %f %f %f %f %f %f %f %f", &serverTime, &arrival,
+			&entry.position.x, &entry.position.y, &entry.position.z, &entry.velocity.x, &entry.velocity.y, &entry.velocity.z,
+			&q.x, &q.y, &q.z, &q.w) != 12)
+		{
+			std::fclose(file);
+			return false;
+		}
+
+		entry.serverTime = serverTime;
+		entry.arrival = arrival;
+		outTrace.push_back(entry);
+	}
+
+	std::fclose(file);
+	std::sort(outTrace.begin(), outTrace.end(), [](const TraceEntry& a, const TraceEntry& b) { return a.serverTime < b.serverTime; });
+	return !outTrace.empty();
+}
+
+bool SaveTrace(const char* path, const Trace& trace)
+{
+	FILE* file = std::fopen(path, "w");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "# serverTime arrival px py pz vx vy vz qx qy qz qw\n");
+	for (const TraceEntry& entry : trace)
+	{
+		const glm::quat& q = entry.orientation;
+		std::fprintf(file, "%llu %lld %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+			(unsigned long long)entry.serverTime, (long long)entry.arrival,
+			entry.position.x, entry.position.y, entry.position.z, entry.velocity.x, entry.velocity.y, entry.velocity.z,
+			q.x, q.y, q.z, q.w);
+	}
+
+	std::fclose(file);
+	return true;
+}
+
+// where the ship really was, linearly between the ticks around the time
+static glm::vec3 PositionAt(const Trace& trace, double time)
+{
+	if (time <= (double)trace.front().serverTime)
+		return trace.front().position;
+	if (time >= (double)trace.back().serverTime)
+		return trace.back().position;
+
+	auto next = std::upper_bound(trace.begin(), trace.end(), time,
+		[](double time, const TraceEntry& entry) { return time < (double)entry.serverTime; });
+	const TraceEntry& a = *(next - 1);
+	const TraceEntry& b = *next;
+	return glm::mix(a.position, b.position, (float)((time - (double)a.serverTime) / (double)(b.serverTime - a.serverTime)));
+}
+
+ReplayResult Replay(const Trace& trace, bool interpolate)
+{
+	ReplayResult result = {};
+
+	// what the client received, in the order it arrived
+	std::vector<const TraceEntry*> received;
+	for (const TraceEntry& entry : trace)
+	{
+		if (entry.arrival >= 0)
+			received.push_back(&entry);
+	}
+	std::stable_sort(received.begin(), received.end(),
+		[](const TraceEntry* a, const TraceEntry* b) { return a->arrival < b->arrival; });
+
+	if (received.empty())
+		return result;
+
+	// quantized the same way the server sends them
+	Game::QuantizationBounds bounds;
+	Game::SpaceShip ship;
+	ship.interpolate = interpolate;
+	Game::PlayoutClock playoutClock;
+
+	const float maxTravel = Game::SpaceShip::boostSpeed * Game::SpaceShip::velocityScale;// units per second
+	uint64 start = (uint64)received.front()->arrival;
+	uint64 end = (uint64)received.back()->arrival + 500;
+	uint64 previousTime = start;
+	uint64 newestServerTime = 0;
+	size_t next = 0;
+	glm::vec3 previousPosition(0.f);
+	double errorSum = 0.0;
+	double delaySum = 0.0;
+
+	for (uint64 frame = 0; ; frame++)
+	{
+		uint64 localTime = start + frame * 1000 / frameRate;
+		if (localTime > end)
+			break;
+
+		while (next < received.size() && (uint64)received[next]->arrival <= localTime)
+		{
+			const TraceEntry& entry = *received[next];
+			glm::vec3 position = Game::DequantizePosition(Game::QuantizePosition(entry.position, bounds.worldBound), bounds.worldBound);
+			glm::vec3 velocity = Game::DequantizeVelocity(Game::QuantizeVelocity(entry.velocity, bounds.maxSpeed), bounds.maxSpeed);
+			glm::quat orientation = Game::DequantizeOrientation(Game::QuantizeOrientation(entry.orientation));
+
+			// the first state is the spawn, the same as SpawnPlayerS2C on a client
+			playoutClock.OnSnapshot(entry.serverTime, (uint64)entry.arrival);
+			ship.SetServerData(position, velocity, glm::vec3(0.f), orientation, next == 0, entry.serverTime);
+			newestServerTime = std::max(newestServerTime, entry.serverTime);
+			next++;
+		}
+
+		float dt = (float)(localTime - previousTime) * 0.001f;
+		previousTime = localTime;
+		double renderTime = playoutClock.GetRenderTime(localTime);
+		ship.ClientUpdate(dt, renderTime);
+
+		// dead reckoning shows the newest state carried forward by the time since it arrived
+		double shownTime = interpolate ? renderTime : (double)ship.drBody.timeStamp + (double)ship.drBody.timeSinceLastUpdate * 1000.0;
+		glm::vec3 shownPosition = ship.position;
+
+		if (localTime >= start + warmupMillis)
+		{
+			float error = glm::distance(shownPosition, PositionAt(trace, shownTime));
+			errorSum += error;
+			delaySum += (double)newestServerTime - shownTime;
+			result.maxError = std::max(result.maxError, error);
+			if (glm::distance(shownPosition, previousPosition) > 1.5f * maxTravel * dt + 0.01f)
+				result.numSnaps++;
+			result.numFrames++;
+		}
+		previousPosition = shownPosition;
+	}
+
+	if (result.numFrames > 0)
+	{
+		result.meanError = (float)(errorSum / result.numFrames);
+		result.meanDelay = (float)(delaySum / result.numFrames);
+	}
+	return result;
+}
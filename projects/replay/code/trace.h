@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+
+// the state one ship had on the server at every tick, and when the snapshots carrying it reached a client
+struct TraceEntry
+{
+	uint64 serverTime;// milliseconds
+	int64 arrival;// client time in milliseconds the state arrived at, -1 if it wasn't sent or was lost
+	glm::vec3 position;
+	glm::vec3 velocity;// linear velocity as it is sent, see SpaceShip::velocityScale
+	glm::quat orientation;
+};
+
+// sorted by server time, one entry per tick
+typedef std::vector<TraceEntry> Trace;
+
+// a ship flown on random input for a while, sent at 20 snapshots per second over a network with latency,
+// jitter, loss and reordering. the same seed always gives the same trace
+Trace GenerateTrace(uint32 seed, float seconds);
+
+// one entry per line: serverTime arrival px py pz vx vy vz qx qy qz qw, lines starting with # are skipped
+bool LoadTrace(const char* path, Trace& outTrace);
+bool SaveTrace(const char* path, const Trace& trace);
+
+struct ReplayResult
+{
+	float meanError;// distance from where the ship really was at the time it is shown for
+	float maxError;
+	float meanDelay;// milliseconds the shown time is behind the newest state received, negative when extrapolating
+	uint32 numSnaps;// frames the ship moved further than it can fly
+	uint32 numFrames;
+};
+
+// plays the trace through a client ship at 120 frames per second, with the snapshot interpolator or with
+// dead reckoning, and measures how far what is drawn is from the real path
+ReplayResult Replay(const Trace& trace, bool interpolate);
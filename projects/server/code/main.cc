@@ -1,9 +1,22 @@
 #include "config.h"
 #include "server_app.h"
+#ifdef SERVER_HEADLESS
+#include "core/cvar.h"
+#include <csignal>
+#endif
 
 int
 main(int argc, const char** argv)
 {
+#ifdef SERVER_HEADLESS
+	// usage: server_headless [address]
+	if (argc > 1)
+		Core::CVarWriteString(Core::CVarCreate(Core::CVar_String, "sv_address", "0.0.0.0"), argv[1]);
+
+	std::signal(SIGINT, [](int) { ServerApp::RequestQuit(); });
+	std::signal(SIGTERM, [](int) { ServerApp::RequestQuit(); });
+#endif
+
 	ServerApp app;
 	if (app.Open())
 	{
@@ -11,4 +24,4 @@ main(int argc, const char** argv)
 		app.Close();
 	}
 	app.Exit();
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include "config.h"
 #include "server_app.h"
+#ifndef SERVER_HEADLESS
 #include "render/renderdevice.h"
 #include "render/cameramanager.h"
 #include "render/shaderresource.h"
@@ -7,35 +8,143 @@
 #include "render/lightserver.h"
 #include "render/debugrender.h"
 #include "render/input/inputserver.h"
+#else
+#include <atomic>
+#endif
 #include "core/random.h"
+#include "core/cvar.h"
+#include "core/timing.h"
 #include <chrono>
+#include <algorithm>
+
+#ifdef SERVER_HEADLESS
+static std::atomic<bool> quitRequested(false);
+#endif
+
+// which kind of traffic each message sent to the clients is
+static Game::Channel ChannelOf(Protocol::PacketType packetType)
+{
+    switch (packetType)
+    {
+    // continuous state, only the newest matters
+    case Protocol::PacketType_WorldSnapshotS2C:
+    case Protocol::PacketType_UpdatePlayerS2C:
+        return Game::Channel::State;
+    // must arrive, and in order relative to each other
+    case Protocol::PacketType_ClientConnectS2C:
+    case Protocol::PacketType_GameStateS2C:
+    case Protocol::PacketType_SpawnPlayerS2C:
+    case Protocol::PacketType_DespawnPlayerS2C:
+    case Protocol::PacketType_SpawnLaserS2C:
+    case Protocol::PacketType_DespawnLaserS2C:
+    case Protocol::PacketType_TeleportPlayerS2C:
+    case Protocol::PacketType_CollisionS2C:
+        return Game::Channel::Events;
+    default:
+        return Game::Channel::Bulk;
+    }
+}
+
+// farthest a space ship moves per second, at boost speed (see SpaceShip::ServerUpdate)
+static const float maxShipTravel = Game::SpaceShip::boostSpeed * Game::SpaceShip::velocityScale;
+
+// what a laser ran into during a tick
+enum LaserHit : uint8
+{
+    LaserHit_None,
+    LaserHit_Ship,
+    LaserHit_Asteroid
+};
+
+// rough wire size of a world snapshot without its entities, including ENet's headers
+static const size_t snapshotHeaderSize = 80;
+
+// rough wire size of one PlayerDelta, its vtable is often shared with the previous entity
+static size_t EstimatePlayerDeltaSize(uint8 changedFields)
+{
+    // unchanged entities are left out of the snapshot
+    if (changedFields == 0)
+        return 0;
+
+    size_t size = 24;
+    if (changedFields & Game::EntityField_Position)
+        size += 8;
+    if (changedFields & Game::EntityField_Velocity)
+        size += 4;
+    if (changedFields & Game::EntityField_Orientation)
+        size += 4;
+    return size;
+}
+
+static Core::CVar* sv_tickrate = nullptr;
+static Core::CVar* sv_maxplayers = nullptr;
+static Core::CVar* sv_snapshotrate = nullptr;
+static Core::CVar* sv_worldbound = nullptr;
+static Core::CVar* sv_maxspeed = nullptr;
+static Core::CVar* sv_recvbatch = nullptr;
+static Core::CVar* sv_netthread = nullptr;
+static Core::CVar* sv_interestradius = nullptr;
+static Core::CVar* sv_interestnear = nullptr;
+static Core::CVar* sv_interestfarrate = nullptr;
+static Core::CVar* sv_peerrate = nullptr;
+static Core::CVar* sv_bandwidthin = nullptr;
+static Core::CVar* sv_bandwidthout = nullptr;
+static Core::CVar* sv_maxrewind = nullptr;
 
 ServerApp::ServerApp():
+#ifndef SERVER_HEADLESS
 	window(nullptr),
 	console(nullptr),
+#endif
 	server(nullptr),
+    simulationTimeMillis(0.0),
     currentTimeMillis(0),
-    spaceShipModel(0),
+    currentTick(0),
+    snapshotSequence(0),
+    receiveBacklog(0),
+    slowestTickMillis(0.f),
     nextSpaceShipId(0),
     spaceShipCollisionRadiusSquared(0.f),
-    laserModel(0),
     nextLaserId(0),
     laserMaxTimeMillis(0),
     laserSpeed(0.f),
     laserCooldown(0.1f),
+    lastLaserUpdateMillis(0)
+#ifndef SERVER_HEADLESS
+    ,
+    spaceShipModel(0),
+    laserModel(0),
     spectate(false),
     spectateIndex(0)
+#endif
 {}
 
 ServerApp::~ServerApp(){}
 
 bool ServerApp::Open()
 {
+	App::Open();
+
+    sv_tickrate = Core::CVarCreate(Core::CVar_Int, "sv_tickrate", "60", "simulation ticks per second");
+    sv_maxplayers = Core::CVarCreate(Core::CVar_Int, "sv_maxplayers", "256", "most clients connected at once, read when the server starts");
+    sv_snapshotrate = Core::CVarCreate(Core::CVar_Int, "sv_snapshotrate", "20", "world snapshots sent to clients per second");
+    sv_worldbound = Core::CVarCreate(Core::CVar_Float, "sv_worldbound", "1024", "largest coordinate on any axis that positions are quantized to");
+    sv_maxspeed = Core::CVarCreate(Core::CVar_Float, "sv_maxspeed", "4", "largest velocity on any axis that velocities are quantized to");
+    sv_netthread = Core::CVarCreate(Core::CVar_Int, "sv_netthread", "0", "1 to service the network on a thread of its own instead of once per tick");
+    sv_recvbatch = Core::CVarCreate(Core::CVar_Int, "sv_recvbatch", "1024", "most client messages handled per tick, the rest wait for the next tick, 0 for no limit");
+    sv_interestradius = Core::CVarCreate(Core::CVar_Float, "sv_interestradius", "200", "entities farther than this from a client's ship are not sent to it");
+    sv_interestnear = Core::CVarCreate(Core::CVar_Float, "sv_interestnear", "60", "entities within this distance are in every snapshot, farther ones less often");
+    sv_interestfarrate = Core::CVarCreate(Core::CVar_Int, "sv_interestfarrate", "3", "entities beyond sv_interestnear are sent every n:th snapshot");
+    sv_peerrate = Core::CVarCreate(Core::CVar_Int, "sv_peerrate", "32000", "bytes per second sent to each client before snapshots start leaving entities out, 0 for no limit");
+    sv_bandwidthin = Core::CVarCreate(Core::CVar_Int, "sv_bandwidthin", "0", "bytes per second the server accepts from all clients together, 0 for no limit, read when the server starts");
+    sv_bandwidthout = Core::CVarCreate(Core::CVar_Int, "sv_bandwidthout", "0", "bytes per second the server sends to all clients together, 0 for no limit, read when the server starts");
+    sv_maxrewind = Core::CVarCreate(Core::CVar_Int, "sv_maxrewind", "500", "most milliseconds hit tests are rewound to match what the shooter saw, 0 to test against the present");
+
+#ifndef SERVER_HEADLESS
     int width = 1280; 
     int height = 720;
 
 	// setup window and rendering
-	App::Open();
 	this->window = new Display::Window;
 	this->window->SetSize(width, height);
 
@@ -54,119 +163,56 @@ bool ServerApp::Open()
     Render::Camera* cam = Render::CameraManager::GetCamera(CAMERA_MAIN);
     cam->projection = glm::perspective(glm::radians(90.0f), float(width) / float(height), 0.01f, 1000.f);
     cam->view = glm::lookAt(glm::vec3(0.f, 0.f, -100.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+#endif
+
+    // clients are told the bounds when they connect, so they can't change while the server is running
+    this->quantizationBounds.worldBound = std::max(1.f, Core::CVarReadFloat(sv_worldbound));
+    this->quantizationBounds.maxSpeed = std::max(0.01f, Core::CVarReadFloat(sv_maxspeed));
 
 	// setup server
 	if (!Game::InitializeENet())
 		return false;
 
+#ifndef SERVER_HEADLESS
 	// setup console commands
     this->console = new Game::Console("console", 128, 128, 10);
 	this->console->SetCommand("server", [this](const std::string& arg)
 	{
-        if (this->server != nullptr)
-            return;
-
-        auto connected = [this](ENetPeer* client)
-        {
-            this->OnClientConnect(client);
-        };
-
-        auto disconnected = [this](ENetPeer* client)
-        {
-            this->OnClientDisconnect(client);
-        };
-
-        this->server = new Game::Server();
-        if (!this->server->Initialize(arg.c_str(), 1234, connected, disconnected))
-        {
-            delete this->server;
-            this->server = nullptr;
-        }
-        else
-        {
-            this->console->AddOutput("[INFO] server created");
-        }
+        this->StartServer(arg.c_str());
 	});
     this->console->SetCommand("msg", [this](const std::string& arg)
     {
         if (this->server == nullptr)
             return;
 
-        flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-        auto outPacket = Protocol::CreateTextS2CDirect(builder, arg.c_str());
-        auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_TextS2C, outPacket.Union());
-        builder.Finish(packetWrapper);
+        Game::MessageBuilder message;
+        auto outPacket = Protocol::CreateTextS2CDirect(message.builder, arg.c_str());
+        auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_TextS2C, outPacket.Union());
+        message.builder.Finish(packetWrapper);
 
-        this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_RELIABLE);
+        this->server->BroadcastData(message, ChannelOf(Protocol::PacketType_TextS2C));
         this->console->AddOutput("[MESSAGE] you: " + arg);
     });
+#else
+    // there is no console to type "server <ip>" into, so start listening right away
+    Core::CVar* sv_address = Core::CVarCreate(Core::CVar_String, "sv_address", "0.0.0.0", "address the headless server listens on");
+    if (!this->StartServer(Core::CVarReadString(sv_address)))
+        return false;
+#endif
 
 	// setup space ships and lasers
 	this->InitSpawnPoints();
-    this->spaceShipModel = Render::LoadModel("assets/space/spaceship.glb");
     this->spaceShipCollisionRadiusSquared = 2.f * 2.f;
-    this->laserModel = Render::LoadModel("assets/space/laser.glb");
     this->laserMaxTimeMillis = 3000;
     this->laserSpeed = 20.f;
+#ifndef SERVER_HEADLESS
+    this->spaceShipModel = Render::LoadModel("assets/space/spaceship.glb");
+    this->laserModel = Render::LoadModel("assets/space/laser.glb");
+#endif
 
-    // load all resources
-    Render::ModelId models[6] = {
-        Render::LoadModel("assets/space/Asteroid_1.glb"),
-        Render::LoadModel("assets/space/Asteroid_2.glb"),
-        Render::LoadModel("assets/space/Asteroid_3.glb"),
-        Render::LoadModel("assets/space/Asteroid_4.glb"),
-        Render::LoadModel("assets/space/Asteroid_5.glb"),
-        Render::LoadModel("assets/space/Asteroid_6.glb")
-    };
-    Physics::ColliderMeshId colliderMeshes[6] = {
-        Physics::LoadColliderMesh("assets/space/Asteroid_1_physics.glb"),
-        Physics::LoadColliderMesh("assets/space/Asteroid_2_physics.glb"),
-        Physics::LoadColliderMesh("assets/space/Asteroid_3_physics.glb"),
-        Physics::LoadColliderMesh("assets/space/Asteroid_4_physics.glb"),
-        Physics::LoadColliderMesh("assets/space/Asteroid_5_physics.glb"),
-        Physics::LoadColliderMesh("assets/space/Asteroid_6_physics.glb")
-    };
-
-    // setup asteroids near
-    for (int i = 0; i < 100; i++)
-    {
-        std::tuple<Render::ModelId, Physics::ColliderId, glm::mat4> asteroid;
-        size_t resourceIndex = (size_t)(Core::FastRandom() % 6);
-        std::get<0>(asteroid) = models[resourceIndex];
-        float span = 20.0f;
-        glm::vec3 translation = glm::vec3(
-            Core::RandomFloatNTP() * span,
-            Core::RandomFloatNTP() * span,
-            Core::RandomFloatNTP() * span
-        );
-        glm::vec3 rotationAxis = normalize(translation);
-        float rotation = translation.x;
-        glm::mat4 transform = glm::rotate(rotation, rotationAxis) * glm::translate(translation);
-        std::get<1>(asteroid) = Physics::CreateCollider(colliderMeshes[resourceIndex], transform);
-        std::get<2>(asteroid) = transform;
-        asteroids.push_back(asteroid);
-    }
-
-    // setup asteroids far
-    for (int i = 0; i < 50; i++)
-    {
-        std::tuple<Render::ModelId, Physics::ColliderId, glm::mat4> asteroid;
-        size_t resourceIndex = (size_t)(Core::FastRandom() % 6);
-        std::get<0>(asteroid) = models[resourceIndex];
-        float span = 80.0f;
-        glm::vec3 translation = glm::vec3(
-            Core::RandomFloatNTP() * span,
-            Core::RandomFloatNTP() * span,
-            Core::RandomFloatNTP() * span
-        );
-        glm::vec3 rotationAxis = normalize(translation);
-        float rotation = translation.x;
-        glm::mat4 transform = glm::rotate(rotation, rotationAxis) * glm::translate(translation);
-        std::get<1>(asteroid) = Physics::CreateCollider(colliderMeshes[resourceIndex], transform);
-        std::get<2>(asteroid) = transform;
-        asteroids.push_back(asteroid);
-    }
+    this->InitAsteroids();
 
+#ifndef SERVER_HEADLESS
     // setup skybox
     std::vector<const char*> skybox
     {
@@ -196,36 +242,68 @@ bool ServerApp::Open()
         );
         Render::LightServer::CreatePointLight(translation, color, Core::RandomFloat() * 4.0f, 1.0f + (15 + Core::RandomFloat() * 10.0f));
     }
+#endif
 
 	return true;
 }
 
 void ServerApp::Run()
 {
+#ifndef SERVER_HEADLESS
     Input::Keyboard* kbd = Input::GetDefaultKeyboard();
+#endif
 
-    std::clock_t c_start = std::clock();
     double dt = 0.01667f;
+    double accumulator = 0.0;
+    auto previousTime = std::chrono::steady_clock::now();
+
+    // the simulation keeps its own clock, it starts at wall time and moves exactly one tick per tick. ticks
+    // that catch up after a stall get the times they would have had, not all the same one
+    this->simulationTimeMillis = (double)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
 
     // game loop
-    while (this->window->IsOpen())
+    while (this->IsRunning())
     {
         auto timeStart = std::chrono::steady_clock::now();
-        auto now = std::chrono::system_clock::now();
-        auto duration = now.time_since_epoch();
-        this->currentTimeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
 
+        // the simulation always advances in fixed steps, independent of how fast frames are produced
+        const double tickDelta = 1.0 / (double)std::max(1, Core::CVarReadInt(sv_tickrate));
+        const uint64 ticksPerSnapshot = (uint64)std::max(1, Core::CVarReadInt(sv_tickrate) / std::max(1, Core::CVarReadInt(sv_snapshotrate)));
+
+        // don't try to catch up on more than a handful of ticks after a stall
+        accumulator += std::chrono::duration<double>(timeStart - previousTime).count();
+        accumulator = std::min(accumulator, tickDelta * 8.0);
+        previousTime = timeStart;
+
+#ifndef SERVER_HEADLESS
         glClear(GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
         glEnable(GL_CULL_FACE);
         glCullFace(GL_BACK);
 
         this->window->Update();
+#endif
 
-        this->UpdateAndDrawLasers();
-        this->UpdateAndDrawSpaceShips(dt);
-        this->UpdateNetwork();
+        while (accumulator >= tickDelta)
+        {
+            auto tickStart = std::chrono::steady_clock::now();
+            this->simulationTimeMillis += tickDelta * 1000.0;
+            this->Tick((float)tickDelta);
+            accumulator -= tickDelta;
+            float tickTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
+            this->slowestTickMillis = std::max(this->slowestTickMillis, tickTime);
+
+            // snapshots go out at a lower rate than the simulation runs
+            if (this->currentTick % ticksPerSnapshot == 0)
+                this->SendSnapshot();
+
+            // everything sent this tick leaves in as few datagrams as possible
+            if (this->server != nullptr)
+                this->server->Flush();
+        }
 
+#ifndef SERVER_HEADLESS
         if (kbd->pressed[Input::Key::Code::End])
         {
             Render::ShaderResource::ReloadShaders();
@@ -236,7 +314,8 @@ void ServerApp::Run()
         }
 
         // spectating
-        size_t nShips = this->spaceShips.size();
+        const std::vector<ENetPeer*>& clients = this->GetClients();
+        size_t nShips = clients.size();
         if (this->spectate && nShips > 0)
         {
             if (kbd->pressed[Input::Key::Left])
@@ -244,20 +323,12 @@ void ServerApp::Run()
             else if (kbd->pressed[Input::Key::Right])
                 this->spectateIndex = (this->spectateIndex + 1) % nShips;
 
-            size_t i = 0;
-            Game::SpaceShip* spectatedShip = nullptr;
-            // this must be the ugliest solution to this problem ever (getting map-element by index)
-            for (auto& spaceShip : this->spaceShips)
-            {
-                if (i == this->spectateIndex)
-                {
-                    spectatedShip = spaceShip.second;
-                    break;
-                }
-                i++;
-            }
-
-            spectatedShip->FollowThisWithCamera(dt);
+            // clients may have left since the last frame
+            this->spectateIndex %= nShips;
+            ENetPeer* spectated = clients[this->spectateIndex];
+            uint32 index = this->ShipIndex(spectated);
+            this->spaceShipRenders[Game::Server::SlotOf(spectated)]->FollowWithCamera(
+                glm::translate(this->ships.positions[index]) * (glm::mat4)this->ships.orientations[index], dt);
         }
         else
         {
@@ -269,10 +340,7 @@ void ServerApp::Run()
         }
 
         // Store all drawcalls in the render device
-        for (auto const& asteroid : this->asteroids)
-        {
-            Render::RenderDevice::Draw(std::get<0>(asteroid), std::get<2>(asteroid));
-        }
+        this->DrawWorld();
 
         // Execute the entire rendering pipeline
         Render::RenderDevice::Render(this->window, dt);
@@ -280,66 +348,235 @@ void ServerApp::Run()
         // transfer new frame to window
         this->window->SwapBuffers();
 
-        auto timeEnd = std::chrono::steady_clock::now();
-        dt = std::min(0.04, std::chrono::duration<double>(timeEnd - timeStart).count());
-
         if (kbd->pressed[Input::Key::Code::Escape])
             break;
+#else
+        // nothing blocks on vsync here, so sleep until the next tick is due
+        Core::SleepUntil(timeStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(tickDelta - accumulator)));
+#endif
+
+        auto timeEnd = std::chrono::steady_clock::now();
+        dt = std::min(0.04, std::chrono::duration<double>(timeEnd - timeStart).count());
     }
 }
 
 void ServerApp::Exit()
 {
-    for (auto& spaceShip : this->spaceShips)
-        delete spaceShip.second;
+    this->ships.Clear();
 
-    for (size_t i = 0; i < this->lasers.size(); i++)
-        delete this->lasers[i];
+    this->lasers.Clear();
+
+#ifndef SERVER_HEADLESS
+    for (Game::SpaceShipRender* spaceShipRender : this->spaceShipRenders)
+        delete spaceShipRender;
 
     this->window->Close();
     delete this->window;
     delete this->console;
+#endif
     delete this->server;
 }
 
 void ServerApp::OnClientConnect(ENetPeer* client)
 {
-    this->console->AddOutput("[INFO] client connected");
+    this->Log("[INFO] client connected");
     this->SpawnSpaceShip(client);
-    this->SendGameState(client);
+    // the client needs the quantization bounds before anything quantized arrives
     this->SendClientConnect(client);
+    this->SendGameState(client);
 }
 
 void ServerApp::OnClientDisconnect(ENetPeer* client)
 {
-    this->console->AddOutput("[INFO] client disconnected");
+    this->Log("[INFO] client disconnected");
     this->DespawnSpaceShip(client);
 }
 
+#ifdef SERVER_HEADLESS
+void ServerApp::RequestQuit()
+{
+    quitRequested = true;
+}
+#endif
+
 void ServerApp::InitSpawnPoints()
 {
-    float radius = 100.f;
-    for (int i = 0; i < 32; i++)
+    // one point per player slot, spread evenly over a band around the asteroid field (a fibonacci lattice);
+    // the band stays clear of the poles, where looking at the center would be parallel to the up vector
+    const float radius = 100.f;
+    const float band = 0.5f;
+    const float goldenAngle = 3.1415f * (3.f - glm::sqrt(5.f));
+    size_t count = (size_t)std::max(1, Core::CVarReadInt(sv_maxplayers));
+
+    this->spawnPoints.clear();
+    this->spawnPoints.reserve(count);
+    for (size_t i = 0; i < count; i++)
     {
-        float angle = (float)i / 33.f * 3.1415f * 2.f;
-        spawnPoints.push_back(glm::vec3(
-            radius * glm::cos(angle),
-            0.f,
-            radius * glm::sin(angle)
+        float height = band * (1.f - 2.f * ((float)i + 0.5f) / (float)count);
+        float ringRadius = glm::sqrt(1.f - height * height);
+        float angle = (float)i * goldenAngle;
+        this->spawnPoints.push_back(radius * glm::vec3(
+            ringRadius * glm::cos(angle),
+            height,
+            ringRadius * glm::sin(angle)
         ));
     }
 }
 
+void ServerApp::InitAsteroids()
+{
+    // the random sequence below must match the client's, so that both end up with the same asteroid field
+#ifndef SERVER_HEADLESS
+    Render::ModelId models[6] = {
+        Render::LoadModel("assets/space/Asteroid_1.glb"),
+        Render::LoadModel("assets/space/Asteroid_2.glb"),
+        Render::LoadModel("assets/space/Asteroid_3.glb"),
+        Render::LoadModel("assets/space/Asteroid_4.glb"),
+        Render::LoadModel("assets/space/Asteroid_5.glb"),
+        Render::LoadModel("assets/space/Asteroid_6.glb")
+    };
+#endif
+    Physics::ColliderMeshId colliderMeshes[6] = {
+        Physics::LoadColliderMesh("assets/space/Asteroid_1_physics.glb"),
+        Physics::LoadColliderMesh("assets/space/Asteroid_2_physics.glb"),
+        Physics::LoadColliderMesh("assets/space/Asteroid_3_physics.glb"),
+        Physics::LoadColliderMesh("assets/space/Asteroid_4_physics.glb"),
+        Physics::LoadColliderMesh("assets/space/Asteroid_5_physics.glb"),
+        Physics::LoadColliderMesh("assets/space/Asteroid_6_physics.glb")
+    };
+
+    // setup asteroids near (first 100) and far (last 50)
+    for (int i = 0; i < 150; i++)
+    {
+        std::tuple<Physics::ColliderId, glm::mat4> asteroid;
+        size_t resourceIndex = (size_t)(Core::FastRandom() % 6);
+        float span = i < 100 ? 20.0f : 80.0f;
+        glm::vec3 translation = glm::vec3(
+            Core::RandomFloatNTP() * span,
+            Core::RandomFloatNTP() * span,
+            Core::RandomFloatNTP() * span
+        );
+        glm::vec3 rotationAxis = normalize(translation);
+        float rotation = translation.x;
+        glm::mat4 transform = glm::rotate(rotation, rotationAxis) * glm::translate(translation);
+        std::get<0>(asteroid) = Physics::CreateCollider(colliderMeshes[resourceIndex], transform);
+        std::get<1>(asteroid) = transform;
+        asteroids.push_back(asteroid);
+#ifndef SERVER_HEADLESS
+        asteroidModels.push_back(models[resourceIndex]);
+#endif
+    }
+}
+
+bool ServerApp::StartServer(const char* serverIP)
+{
+    if (this->server != nullptr)
+        return true;
+
+    auto connected = [this](ENetPeer* client)
+    {
+        this->OnClientConnect(client);
+    };
+
+    auto disconnected = [this](ENetPeer* client)
+    {
+        this->OnClientDisconnect(client);
+    };
+
+    this->server = new Game::Server();
+    if (!this->server->Initialize(serverIP, 1234, (size_t)std::max(1, Core::CVarReadInt(sv_maxplayers)), connected, disconnected))
+    {
+        delete this->server;
+        this->server = nullptr;
+        return false;
+    }
+
+    // per client state lives in flat arrays indexed by peer slot
+    size_t maxPeers = this->server->GetMaxPeers();
+    this->shipHandles.assign(maxPeers, Game::invalidShipHandle);
+    this->inputQueues.resize(maxPeers);
+    this->relevantSets.resize(maxPeers);
+    this->sendPriorities.resize(maxPeers);
+    this->viewDelays.assign(maxPeers, 0);
+    // far enough back for the longest rewind, plus the tick after it to interpolate towards
+    uint32 rewindTicks = (uint32)((int64)std::max(0, Core::CVarReadInt(sv_maxrewind)) * std::max(1, Core::CVarReadInt(sv_tickrate)) / 1000);
+    this->shipHistory.Resize(maxPeers, rewindTicks + 2, this->currentTick);
+#ifndef SERVER_HEADLESS
+    this->spaceShipRenders.assign(maxPeers, nullptr);
+#endif
+
+    // ENet splits the outgoing bandwidth between the clients, and asks them to stay below the incoming one
+    this->server->SetBandwidthLimit((enet_uint32)std::max(0, Core::CVarReadInt(sv_bandwidthin)),
+        (enet_uint32)std::max(0, Core::CVarReadInt(sv_bandwidthout)));
+
+    // received messages then wait for the next tick in a queue instead of in the socket
+    if (Core::CVarReadInt(sv_netthread) != 0)
+        this->server->StartNetworkThread();
+
+    this->server->GetStats().SetMessageTypeNames(Protocol::EnumNamesPacketType());
+#ifndef SERVER_HEADLESS
+    this->console->SetNetStats(&this->server->GetStats());
+#endif
+
+    this->Log("[INFO] server created");
+    return true;
+}
+
+bool ServerApp::IsRunning()
+{
+#ifndef SERVER_HEADLESS
+    return this->window->IsOpen();
+#else
+    return !quitRequested;
+#endif
+}
+
+const std::vector<ENetPeer*>& ServerApp::GetClients() const
+{
+    static const std::vector<ENetPeer*> noClients;
+    return this->server != nullptr ? this->server->connectedPeers : noClients;
+}
+
+uint32 ServerApp::ShipIndex(ENetPeer* client) const
+{
+    return this->ships.IndexOf(this->shipHandles[Game::Server::SlotOf(client)]);
+}
+
+void ServerApp::Log(const std::string& message)
+{
+#ifndef SERVER_HEADLESS
+    this->console->AddOutput(message);
+#else
+    printf("%s\n", message.c_str());
+#endif
+}
+
 
 // -- update functions --
 
-void ServerApp::RenderUI()
+void ServerApp::Tick(float deltaTime)
 {
-    if (this->window->IsOpen())
+    this->currentTimeMillis = (uint64)this->simulationTimeMillis;
+
+    // every client gets a tick's worth of bytes, and can save up a quarter of a second for the next snapshot
+    if (this->server != nullptr)
     {
-        this->console->Draw();
-        Debug::DispatchDebugTextDrawing();
+        size_t rate = (size_t)std::max(0, Core::CVarReadInt(sv_peerrate));
+        this->server->RefillSendBudgets(rate, deltaTime, rate / 4);
     }
+
+    this->UpdateNetwork();
+    this->UpdateInterest();
+    this->UpdateLasers();
+    this->UpdateSpaceShips(deltaTime);
+    this->RecordHistory();
+
+    // everything received this tick has been handled
+    if (this->server != nullptr)
+        this->server->ReleaseReceivedData();
+
+    this->currentTick++;
 }
 
 void ServerApp::UpdateNetwork()
@@ -347,12 +584,13 @@ void ServerApp::UpdateNetwork()
     if (this->server == nullptr)
         return;
 
+    this->server->SetReceiveBatchSize((size_t)std::max(0, Core::CVarReadInt(sv_recvbatch)));
     this->server->Update();
 
     Game::Data d;
-    while (this->server->PopDataStack(d))
+    while (this->server->PopData(d))
     {
-        auto packet = Protocol::GetPacketWrapper(&d.data->front());
+        auto packet = Protocol::GetPacketWrapper(d.GetData());
         Protocol::PacketType packetType = packet->packet_type();
         switch (packetType)
         {
@@ -364,147 +602,289 @@ void ServerApp::UpdateNetwork()
             break;
         }
     }
+
+    // report when messages start piling up over the batch size, not every tick they do
+    size_t queueDepth = this->server->GetQueueDepth();
+    if (queueDepth > 0 && this->receiveBacklog == 0)
+        this->Log("[WARNING] receive queue backed up, " + std::to_string(queueDepth) + " messages deferred to the next tick");
+    this->receiveBacklog = queueDepth;
+}
+
+void ServerApp::UpdateInterest()
+{
+    float radius = std::max(1.f, Core::CVarReadFloat(sv_interestradius));
+
+    // one cell per interest radius keeps every query within 27 cells
+    this->interestGrid.Clear(radius);
+    for (size_t i = 0; i < this->ships.Size(); i++)
+        this->interestGrid.Insert((uint32)i, this->ships.positions[i]);
+
+    for (size_t i = 0; i < this->ships.Size(); i++)
+    {
+        uint32 slot = this->ships.owners[i];
+        this->relevantSets[slot].clear();
+        this->interestGrid.Query(this->ships.positions[i], radius, this->relevantSets[slot]);
+    }
 }
 
-void ServerApp::UpdateAndDrawSpaceShips(float deltaTime)
+void ServerApp::UpdateSpaceShips(float deltaTime)
 {
-    for (auto& spaceShip : this->spaceShips)
+    for (size_t i = 0; i < this->ships.Size(); i++)
     {
-        spaceShip.second->timeSinceLastLaser += deltaTime;
+        uint32 slot = this->ships.owners[i];
+        this->ships.laserTimers[i] += deltaTime;
+
+        // clients that predict their ship send an input per tick, and replay them in the same order
+        Game::InputData input;
+        if (this->inputQueues[slot].Pop(input))
+            this->ships.inputs[i] = input.ToBits();
 
         // fire laser
-        if (spaceShip.second->inputData.space && spaceShip.second->timeSinceLastLaser >= this->laserCooldown)
+        if ((this->ships.inputs[i] & Game::InputBit_Space) && this->ships.laserTimers[i] >= this->laserCooldown)
         {
-            spaceShip.second->timeSinceLastLaser = 0.f;
-            this->SpawnLaser(spaceShip.second->position, spaceShip.second->orientation,
-                spaceShip.second->id, this->currentTimeMillis);
+            this->ships.laserTimers[i] = 0.f;
+            this->SpawnLaser(this->ships.positions[i], this->ships.orientations[i],
+                this->ships.ids[i], this->currentTimeMillis, this->viewDelays[slot]);
         }
 
-        // check asteroid collisions and previously detected hits
-        if (spaceShip.second->CheckCollisions())
-        {
-            this->RespawnSpaceShip(spaceShip.first);
-            continue;
-        }
-        else
-        {
-            // check collisions with other space ships
-            for (auto& otherShip : this->spaceShips)
-            {
-                if (otherShip.second == spaceShip.second)
-                    continue;
-
-                glm::vec3 diff = otherShip.second->position - spaceShip.second->position;
-                if (glm::dot(diff, diff) < this->spaceShipCollisionRadiusSquared)
-                {
-                    spaceShip.second->isHit = true;
-                    otherShip.second->isHit = true;
-                }
-            }
-
-            // if a new collision is detected => respawn
-            if (spaceShip.second->isHit)
-            {
-                this->RespawnSpaceShip(spaceShip.first);
-                continue;
-            }
-        }
+        // check asteroid collisions, lasers have already marked their hits
+        if (!this->ships.hits[i] && Game::CheckAsteroidCollisions(this->ships.positions[i], this->ships.orientations[i]))
+            this->ships.hits[i] = 1;
+    }
 
-        spaceShip.second->ServerUpdate(deltaTime);
-        this->UpdateSpaceShipData(spaceShip.first);
+    // check collisions with other space ships, each close pair once
+    this->collisionGrid.Build(this->ships.positions.data(), this->ships.Size(), glm::sqrt(this->spaceShipCollisionRadiusSquared));
+    this->collisionPairs.clear();
+    this->collisionGrid.FindPairs(this->spaceShipCollisionRadiusSquared, this->collisionPairs);
+    for (const Game::CollisionPair& pair : this->collisionPairs)
+    {
+        this->ships.hits[pair.a] = 1;
+        this->ships.hits[pair.b] = 1;
+    }
 
-        Render::RenderDevice::Draw(this->spaceShipModel, spaceShip.second->transform);
+    // everything that was hit respawns, and moves from its spawn point this tick
+    for (size_t i = 0; i < this->ships.Size(); i++)
+    {
+        if (this->ships.hits[i])
+            this->RespawnSpaceShip((uint32)i);
     }
+
+    Game::IntegrateShips(this->ships, deltaTime);
 }
 
-void ServerApp::UpdateAndDrawLasers()
+void ServerApp::UpdateLasers()
 {
-    for (int i = (int)this->lasers.size() - 1; i >= 0; i--)
+    // check timeout
+    for (int i = (int)this->lasers.Size() - 1; i >= 0; i--)
     {
-        // check timeout
-        if (this->lasers[i]->ShouldDespawn(this->currentTimeMillis))
-        {
+        if (this->lasers.ShouldDespawn(i, this->currentTimeMillis))
             this->DespawnLaser(i);
-            continue;
-        }
+    }
+
+    // every laser is tested along the whole way it flew since the last tick, so nothing it passed between two
+    // ticks is missed however long they were. the segments of all lasers are worked out together
+    this->lasers.GetSweeps(this->lastLaserUpdateMillis, this->currentTimeMillis, this->laserSpeed, this->laserSweepStarts, this->laserSweepLengths);
+    this->lastLaserUpdateMillis = this->currentTimeMillis;
+    this->laserHits.assign(this->lasers.Size(), LaserHit_None);
 
-        // check space ship collision
-        bool hitShip = false;
-        glm::vec3 currentPos = this->lasers[i]->GetCurrentPosition(this->currentTimeMillis, this->laserSpeed);
-        for (auto& spaceShip : this->spaceShips)
+    // check space ship collision, against where the ships were in the world the shooter was looking at.
+    // only ships that could have been within reach of the segment since then are rewound
+    float collisionRadius = glm::sqrt(this->spaceShipCollisionRadiusSquared);
+    for (size_t i = 0; i < this->lasers.Size(); i++)
+    {
+        const glm::vec3& start = this->laserSweepStarts[i];
+        const glm::vec3& direction = this->lasers.directions[i];
+        float length = this->laserSweepLengths[i];
+        uint64 rewindMillis = this->laserRewinds[i];
+        double viewTick = this->shipHistory.TickAt(this->currentTimeMillis - std::min(rewindMillis, this->currentTimeMillis));
+        float reach = collisionRadius + 0.5f * length + maxShipTravel * (float)rewindMillis * 0.001f;
+
+        this->hitCandidates.clear();
+        this->interestGrid.Query(start + direction * (0.5f * length), reach, this->hitCandidates);
+        for (const Game::InterestEntry& candidate : this->hitCandidates)
         {
-            if (spaceShip.second->id == this->lasers[i]->spaceShipId)// ignore the ship it was fired from
+            uint32 index = candidate.index;
+            if (this->ships.ids[index] == this->lasers.spaceShipIds[i])// ignore the ship it was fired from
                 continue;
 
-            glm::vec3 diff = currentPos - spaceShip.second->position;
-            if (glm::dot(diff, diff) < this->spaceShipCollisionRadiusSquared)
+            glm::vec3 center = this->shipHistory.PositionAt(this->ships.owners[index], viewTick);
+            if (Game::SegmentHitsSphere(start, direction, length, center, this->spaceShipCollisionRadiusSquared))
             {
-                spaceShip.second->isHit = true;
-                hitShip = true;
+                this->ships.hits[index] = 1;
+                this->laserHits[i] = LaserHit_Ship;
                 break;
             }
         }
+    }
 
-        if (hitShip)
+    // check asteroid collision, lasers that hit a ship fly on
+    for (size_t i = 0; i < this->lasers.Size(); i++)
+    {
+        if (this->laserHits[i] != LaserHit_None)
             continue;
 
-        // check asteroid collision
-        glm::vec3 direction = this->lasers[i]->GetDirection();
-        float maxDist = 1.f;
-
-        Physics::RaycastPayload raycastResult = Physics::Raycast(currentPos, direction, maxDist);
+        Physics::RaycastPayload raycastResult = Physics::Raycast(this->laserSweepStarts[i], this->lasers.directions[i], this->laserSweepLengths[i]);
         if (raycastResult.hit)
-        {
+            this->laserHits[i] = LaserHit_Asteroid;
+    }
+
+    // backwards, a despawned laser's place is taken by one that was already looked at
+    for (int i = (int)this->lasers.Size() - 1; i >= 0; i--)
+    {
+        if (this->laserHits[i] == LaserHit_Asteroid)
             this->DespawnLaser(i);
-            continue;
-        }
+    }
+}
+
+void ServerApp::RecordHistory()
+{
+    if (this->server == nullptr)
+        return;
 
-        // draw
-        Render::RenderDevice::Draw(this->laserModel, this->lasers[i]->GetLocalToWorld(currentTimeMillis, this->laserSpeed));
+    // the positions snapshots sent after this tick carry, at the time they are stamped with
+    this->shipHistory.BeginTick(this->currentTick, this->currentTimeMillis);
+    for (size_t i = 0; i < this->ships.Size(); i++)
+        this->shipHistory.Record(this->ships.owners[i], this->ships.positions[i]);
+}
+
+#ifndef SERVER_HEADLESS
+void ServerApp::RenderUI()
+{
+    if (this->window->IsOpen())
+    {
+        this->console->Draw();
+        Debug::DispatchDebugTextDrawing();
     }
 }
 
+void ServerApp::DrawWorld()
+{
+    for (size_t i = 0; i < this->asteroids.size(); i++)
+    {
+        Render::RenderDevice::Draw(this->asteroidModels[i], std::get<1>(this->asteroids[i]));
+    }
+
+    for (size_t i = 0; i < this->ships.Size(); i++)
+    {
+        glm::mat4 transform = glm::translate(this->ships.positions[i]) * (glm::mat4)this->ships.orientations[i];
+        this->spaceShipRenders[this->ships.owners[i]]->Update(transform, this->ships.speeds[i]);
+        Render::RenderDevice::Draw(this->spaceShipModel, transform);
+    }
+
+    for (size_t i = 0; i < this->lasers.Size(); i++)
+    {
+        Render::RenderDevice::Draw(this->laserModel, this->lasers.GetLocalToWorld(i, this->currentTimeMillis, this->laserSpeed));
+    }
+}
+#endif
+
 
 // -- unpack messages from client --
 
-void ServerApp::PackPlayer(Game::SpaceShip* spaceShip, Protocol::Player& p_player)
+void ServerApp::PackPlayer(uint32 shipIndex, Protocol::Player& p_player)
 {
-    auto p_position = Protocol::Vec3(spaceShip->position.x, spaceShip->position.y, spaceShip->position.z);
-    auto p_velocity = Protocol::Vec3(spaceShip->linearVelocity.x, spaceShip->linearVelocity.y, spaceShip->linearVelocity.z);
+    const glm::vec3& position = this->ships.positions[shipIndex];
+    const glm::vec3& velocity = this->ships.velocities[shipIndex];
+    const glm::quat& orientation = this->ships.orientations[shipIndex];
+    auto p_position = Protocol::Vec3(position.x, position.y, position.z);
+    auto p_velocity = Protocol::Vec3(velocity.x, velocity.y, velocity.z);
     auto p_acceleration = Protocol::Vec3(0.f, 0.f, 0.f);
-    auto p_orientation = Protocol::Vec4(spaceShip->orientation.x, spaceShip->orientation.y, spaceShip->orientation.z, spaceShip->orientation.w);
-    p_player = Protocol::Player(spaceShip->id, p_position, p_velocity, p_acceleration, p_orientation);
+    auto p_orientation = Protocol::Vec4(orientation.x, orientation.y, orientation.z, orientation.w);
+    p_player = Protocol::Player(this->ships.ids[shipIndex], p_position, p_velocity, p_acceleration, p_orientation);
 }
 
-void ServerApp::PackLaser(Game::Laser* laser, Protocol::Laser& p_laser)
+void ServerApp::PackLaser(size_t laserIndex, Protocol::Laser& p_laser)
 {
-    auto p_origin = Protocol::Vec3(laser->origin.x, laser->origin.y, laser->origin.z);
-    auto p_orientation = Protocol::Vec4(laser->orientation.x, laser->orientation.y, laser->orientation.z, laser->orientation.w);
-    p_laser = Protocol::Laser(laser->id, laser->spawnTimeMillis, laser->despawnTimeMillis, p_origin, p_orientation);
+    const glm::vec3& origin = this->lasers.origins[laserIndex];
+    const glm::quat& orientation = this->lasers.orientations[laserIndex];
+    auto p_origin = Protocol::Vec3(origin.x, origin.y, origin.z);
+    auto p_orientation = Protocol::Vec4(orientation.x, orientation.y, orientation.z, orientation.w);
+    p_laser = Protocol::Laser(this->lasers.ids[laserIndex], this->lasers.spawnTimes[laserIndex], this->lasers.despawnTimes[laserIndex], p_origin, p_orientation);
+}
+
+void ServerApp::PackQuantizedPlayer(uint32 shipIndex, Protocol::QuantizedPlayer& p_player)
+{
+    glm::i16vec3 position = Game::QuantizePosition(this->ships.positions[shipIndex], this->quantizationBounds.worldBound);
+    auto p_position = Protocol::QuantizedVec3(position.x, position.y, position.z);
+    auto p_velocity = Protocol::PackedVelocity(Game::QuantizeVelocity(this->ships.velocities[shipIndex], this->quantizationBounds.maxSpeed));
+    auto p_orientation = Protocol::PackedQuat(Game::QuantizeOrientation(this->ships.orientations[shipIndex]));
+    p_player = Protocol::QuantizedPlayer(this->ships.ids[shipIndex], p_position, p_velocity, p_orientation);
+}
+
+void ServerApp::PackQuantizedLaser(size_t laserIndex, Protocol::QuantizedLaser& p_laser)
+{
+    glm::i16vec3 origin = Game::QuantizePosition(this->lasers.origins[laserIndex], this->quantizationBounds.worldBound);
+    auto p_origin = Protocol::QuantizedVec3(origin.x, origin.y, origin.z);
+    auto p_orientation = Protocol::PackedQuat(Game::QuantizeOrientation(this->lasers.orientations[laserIndex]));
+    p_laser = Protocol::QuantizedLaser(this->lasers.ids[laserIndex], this->lasers.spawnTimes[laserIndex], this->lasers.despawnTimes[laserIndex], p_origin, p_orientation);
+}
+
+bool ServerApp::PackSnapshot(const Game::Snapshot* baseline, const Game::Snapshot& snapshot, uint32 inputAck, flatbuffers::FlatBufferBuilder& builder)
+{
+    std::vector<Game::EntityDelta> deltas;
+    std::vector<uint32> removed;
+    Game::DiffSnapshots(baseline, snapshot, deltas);
+    Game::DiffRemoved(baseline, snapshot, removed);
+
+    if (deltas.empty() && removed.empty())
+        return false;
+
+    // fields that didn't change since the baseline are left out of the table entirely
+    std::vector<flatbuffers::Offset<Protocol::PlayerDelta>> p_players;
+    p_players.reserve(deltas.size());
+    for (const Game::EntityDelta& delta : deltas)
+    {
+        const Game::EntityState* state = delta.state;
+        auto p_position = Protocol::QuantizedVec3(state->position.x, state->position.y, state->position.z);
+        auto p_velocity = Protocol::PackedVelocity(state->velocity);
+        auto p_orientation = Protocol::PackedQuat(state->orientation);
+
+        p_players.push_back(Protocol::CreatePlayerDelta(builder, state->id,
+            (delta.changedFields & Game::EntityField_Position) ? &p_position : nullptr,
+            (delta.changedFields & Game::EntityField_Velocity) ? &p_velocity : nullptr,
+            (delta.changedFields & Game::EntityField_Orientation) ? &p_orientation : nullptr));
+    }
+
+    uint32 baselineSequence = baseline != nullptr ? baseline->sequence : 0;
+    auto outPacket = Protocol::CreateWorldSnapshotS2CDirect(builder, snapshot.time, snapshot.sequence, baselineSequence, &p_players, this->slowestTickMillis, inputAck, removed.empty() ? nullptr : &removed);
+    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_WorldSnapshotS2C, outPacket.Union());
+    builder.Finish(packetWrapper);
+    return true;
 }
 
 void ServerApp::HandleMessage_Input(ENetPeer* sender, const Protocol::PacketWrapper* packet)
 {
-    if (this->spaceShips.count(sender) == 0)
+    Game::ShipHandle handle = this->shipHandles[Game::Server::SlotOf(sender)];
+    if (!this->ships.IsValid(handle))
         return;
 
     const Protocol::InputC2S* inPacket = static_cast<const Protocol::InputC2S*>(packet->packet());
+    uint32 shipIndex = this->ships.IndexOf(handle);
 
-    unsigned short inputData = inPacket->bitmap();
+    // predicted inputs wait for a tick each, the others take effect right away unless a newer one already did
+    if (inPacket->sequence() != 0)
+    {
+        Game::InputData data;
+        data.FromBits(inPacket->bitmap());
+        data.timeStamp = inPacket->time();
+        this->inputQueues[Game::Server::SlotOf(sender)].Push(inPacket->sequence(), data);
+    }
+    else if (inPacket->time() > this->ships.inputTimes[shipIndex])
+    {
+        this->ships.inputs[shipIndex] = inPacket->bitmap();
+        this->ships.inputTimes[shipIndex] = inPacket->time();
+    }
 
-    Game::InputData data;
-    data.w = inputData & 1;
-    data.a = inputData & 2;
-    data.d = inputData & 4;
-    data.up = inputData & 8;
-    data.down = inputData & 16;
-    data.left = inputData & 32;
-    data.right = inputData & 64;
-    data.space = inputData & 128;
-    data.shift = inputData & 256;
-    data.timeStamp = inPacket->time();
+    // lasers fired from now on are tested against what the client is showing, within reason
+    uint64 viewTime = inPacket->view_time();
+    uint64 maxRewind = (uint64)std::max(0, Core::CVarReadInt(sv_maxrewind));
+    uint64 viewDelay = viewTime != 0 && viewTime < this->currentTimeMillis ? this->currentTimeMillis - viewTime : 0;
+    this->viewDelays[Game::Server::SlotOf(sender)] = std::min(viewDelay, maxRewind);
 
-    this->spaceShips[sender]->CompareAndSetImputData(data);
+    // the newest snapshot the client has seen becomes the baseline for its next delta
+    Game::SnapshotHistory* history = this->server->GetSnapshotHistory(sender);
+    if (history != nullptr)
+        history->Ack(inPacket->snapshot_ack());
 }
 
 void ServerApp::HandleMessage_Text(ENetPeer* sender, const Protocol::PacketWrapper* packet)
@@ -514,14 +894,14 @@ void ServerApp::HandleMessage_Text(ENetPeer* sender, const Protocol::PacketWrapp
     // print incomming text
     std::string msg = "[MESSAGE] other: ";
     msg += inPacket->text()->c_str();
-    this->console->AddOutput(msg);
+    this->Log(msg);
 
     // send text to all others (exluding sender)
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    auto outPacket = Protocol::CreateTextS2CDirect(builder, inPacket->text()->c_str());
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_TextS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_RELIABLE, sender);
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateTextS2CDirect(message.builder, inPacket->text()->c_str());
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_TextS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->server->BroadcastData(message, ChannelOf(Protocol::PacketType_TextS2C), sender);
 }
 
 
@@ -530,138 +910,284 @@ void ServerApp::HandleMessage_Text(ENetPeer* sender, const Protocol::PacketWrapp
 void ServerApp::SpawnSpaceShip(ENetPeer* client)
 {
     static size_t spawnIndex = 0;
-    Game::SpaceShip* spaceShip = new Game::SpaceShip();
-    spaceShip->id = this->nextSpaceShipId;
-    spaceShip->position = this->spawnPoints[spawnIndex++ % 32];
-    spaceShip->orientation = glm::quatLookAt(glm::normalize(spaceShip->position), glm::vec3(0.f, 1.f, 0.f));
-    this->spaceShips[client] = spaceShip;
+    uint32 slot = Game::Server::SlotOf(client);
+    glm::vec3 position = this->spawnPoints[spawnIndex++ % this->spawnPoints.size()];
+    glm::quat orientation = glm::quatLookAt(glm::normalize(position), glm::vec3(0.f, 1.f, 0.f));
+    this->shipHandles[slot] = this->ships.Add(this->nextSpaceShipId, slot, position, orientation);
+    this->shipHistory.Reset(slot, position);
+    this->viewDelays[Game::Server::SlotOf(client)] = 0;
+    this->inputQueues[Game::Server::SlotOf(client)].Clear();
     this->nextSpaceShipId++;
+#ifndef SERVER_HEADLESS
+    this->spaceShipRenders[Game::Server::SlotOf(client)] = new Game::SpaceShipRender();
+#endif
 
     // send messages to others
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
+    Game::MessageBuilder message;
     Protocol::Player p_player;
-    this->PackPlayer(spaceShip, p_player);
-    auto outPacket = Protocol::CreateSpawnPlayerS2C(builder, &p_player);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_SpawnPlayerS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
+    this->PackPlayer(this->ships.IndexOf(this->shipHandles[slot]), p_player);
+    auto outPacket = Protocol::CreateSpawnPlayerS2C(message.builder, &p_player);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_SpawnPlayerS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
     // exlude client, since it will receive everything in the gameState-message
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_RELIABLE, client);
+    this->server->BroadcastData(message, ChannelOf(Protocol::PacketType_SpawnPlayerS2C), client);
 }
 
-void ServerApp::UpdateSpaceShipData(ENetPeer* client)
+void ServerApp::SendSnapshot()
 {
-    Game::SpaceShip* spaceShip = spaceShips[client];
+    if (this->server == nullptr || this->server->connectedPeers.empty())
+        return;
 
-    // send messages to others
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    Protocol::Player p_player;
-    this->PackPlayer(spaceShip, p_player);
-    auto outPacket = Protocol::CreateUpdatePlayerS2C(builder, this->currentTimeMillis, &p_player);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_UpdatePlayerS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+    // capture the world once, sorted by id so that it can be diffed against older snapshots
+    Game::Snapshot world;
+    world.sequence = ++this->snapshotSequence;
+    world.time = this->currentTimeMillis;
+    world.entities.reserve(this->ships.Size());
+    for (size_t i = 0; i < this->ships.Size(); i++)
+    {
+        world.entities.push_back({
+            this->ships.ids[i],
+            Game::QuantizePosition(this->ships.positions[i], this->quantizationBounds.worldBound),
+            Game::QuantizeVelocity(this->ships.velocities[i], this->quantizationBounds.maxSpeed),
+            Game::QuantizeOrientation(this->ships.orientations[i])
+        });
+    }
+    std::sort(world.entities.begin(), world.entities.end(),
+        [](const Game::EntityState& a, const Game::EntityState& b) { return a.id < b.id; });
+
+    float nearRadius = Core::CVarReadFloat(sv_interestnear);
+    float nearRadiusSquared = nearRadius * nearRadius;
+    float farWeight = 1.f / (float)std::max(1, Core::CVarReadInt(sv_interestfarrate));
+
+    std::vector<Game::InterestPriority> priorities;
+    std::vector<Game::InterestPriority> candidates;
+    for (ENetPeer* peer : this->server->connectedPeers)
+    {
+        Game::SnapshotHistory* history = this->server->GetSnapshotHistory(peer);
+        if (history == nullptr)
+            continue;
+
+        uint32 slot = Game::Server::SlotOf(peer);
+        const Game::Snapshot* baseline = history->baseline.get();
+
+        // each peer's snapshot is what the client will have after decoding it: entities it already knows
+        // keep their acknowledged state, unless they are sent this time
+        auto snapshot = std::make_shared<Game::Snapshot>();
+        snapshot->sequence = world.sequence;
+        snapshot->time = world.time;
+        if (baseline != nullptr)
+        {
+            for (const Game::EntityState& state : baseline->entities)
+            {
+                if (world.Find(state.id) != nullptr)
+                    snapshot->entities.push_back(state);
+            }
+        }
+
+        // reliable events sent this tick were already charged, snapshots get whatever is left. the peer's own
+        // ship is in every snapshot whatever the budget, it is what the client's prediction is checked against
+        uint32 ownId = this->ships.ids[this->ShipIndex(peer)];
+        const Game::EntityState& ownState = *world.Find(ownId);
+        const Game::EntityState* ownKnown = baseline != nullptr ? baseline->Find(ownId) : nullptr;
+        int64 budget = this->server->GetSendBudget(peer) - (int64)snapshotHeaderSize - (int64)EstimatePlayerDeltaSize(Game::DiffEntity(ownKnown, ownState));
+        snapshot->FindOrAdd(ownId) = ownState;
+
+        // near entities gain a full point of priority per snapshot and far ones a fraction, so far ones are
+        // due every few snapshots. whatever is left out keeps its priority, and is first in line next time
+        const std::vector<Game::InterestPriority>& previous = this->sendPriorities[slot];
+        priorities.clear();
+        candidates.clear();
+        for (const Game::InterestEntry& entry : this->relevantSets[slot])
+        {
+            uint32 id = this->ships.ids[entry.index];
+            if (id == ownId)
+                continue;
+
+            auto it = std::lower_bound(previous.begin(), previous.end(), id,
+                [](const Game::InterestPriority& p, uint32 id) { return p.id < id; });
+            float priority = (it != previous.end() && it->id == id) ? it->priority : 0.f;
+            priority += entry.distanceSquared > nearRadiusSquared ? farWeight : 1.f;
+
+            priorities.push_back({ id, priority });
+            if (priority >= 1.f)
+                candidates.push_back({ id, priority });
+        }
+        std::sort(priorities.begin(), priorities.end(),
+            [](const Game::InterestPriority& a, const Game::InterestPriority& b) { return a.id < b.id; });
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Game::InterestPriority& a, const Game::InterestPriority& b) { return a.priority > b.priority; });
+
+        for (const Game::InterestPriority& candidate : candidates)
+        {
+            const Game::EntityState& state = *world.Find(candidate.id);
+            const Game::EntityState* known = baseline != nullptr ? baseline->Find(candidate.id) : nullptr;
+            int64 size = (int64)EstimatePlayerDeltaSize(Game::DiffEntity(known, state));
+            if (size > budget)
+                continue;
+
+            budget -= size;
+            snapshot->FindOrAdd(candidate.id) = state;
+            std::lower_bound(priorities.begin(), priorities.end(), candidate.id,
+                [](const Game::InterestPriority& p, uint32 id) { return p.id < id; })->priority = 0.f;
+        }
+        this->sendPriorities[slot].swap(priorities);
+
+        // nothing relevant changed since the baseline, the peer is already up to date
+        Game::MessageBuilder message;
+        if (!this->PackSnapshot(baseline, *snapshot, this->inputQueues[slot].GetProcessedSequence(), message.builder))
+            continue;
+
+        history->sent.Store(snapshot);
+        this->server->SendData(message, peer, ChannelOf(Protocol::PacketType_WorldSnapshotS2C));
+    }
+
+    this->slowestTickMillis = 0.f;
+}
+
+void ServerApp::SendToNearbyPeers(const glm::vec3& position, float radius, Game::MessageBuilder& message, Game::Channel channel)
+{
+    // the interest grid is only in step with the ships during a tick, and this is also called while the network
+    // is polled and ships come and go, so the ships are checked directly
+    float radiusSq = radius * radius;
+    for (size_t i = 0; i < this->ships.Size(); i++)
+    {
+        glm::vec3 offset = this->ships.positions[i] - position;
+        if (glm::dot(offset, offset) > radiusSq)
+            continue;
+
+        ENetPeer* peer = this->server->GetPeer(this->ships.owners[i]);
+        if (peer != nullptr)
+            this->server->SendData(message, peer, channel);
+    }
 }
 
 void ServerApp::DespawnSpaceShip(ENetPeer* client)
 {
-    uint32 id = this->spaceShips[client]->id;
-    delete this->spaceShips[client];
-    this->spaceShips.erase(client);
+    uint32 slot = Game::Server::SlotOf(client);
+    uint32 id = this->ships.ids[this->ShipIndex(client)];
+
+    // lasers leave with the ship that fired them
+    for (int i = (int)this->lasers.Size()-1; i>=0; i--)
+    {
+        if (this->lasers.spaceShipIds[i] == id)
+            this->DespawnLaser(i);
+    }
+
+    this->ships.Remove(this->shipHandles[slot]);
+    this->shipHandles[slot] = Game::invalidShipHandle;
+    this->relevantSets[slot].clear();
+    this->sendPriorities[slot].clear();
+#ifndef SERVER_HEADLESS
+    delete this->spaceShipRenders[slot];
+    this->spaceShipRenders[slot] = nullptr;
+#endif
 
     // send message to others (exluding the sender, since they are not connected any more)
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    auto outPacket = Protocol::CreateDespawnPlayerS2C(builder, id);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_DespawnPlayerS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_RELIABLE, client);
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateDespawnPlayerS2C(message.builder, id);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_DespawnPlayerS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->server->BroadcastData(message, ChannelOf(Protocol::PacketType_DespawnPlayerS2C), client);
 }
 
-void ServerApp::RespawnSpaceShip(ENetPeer* client)
+void ServerApp::RespawnSpaceShip(uint32 shipIndex)
 {
     static size_t spawnIndex = 16;
     spawnIndex ^= (spawnIndex << 13);
     spawnIndex ^= (spawnIndex >> 17);
     spawnIndex ^= (spawnIndex << 5);
 
-    Game::SpaceShip* spaceShip = this->spaceShips[client];
-    spaceShip->isHit = false;
-    spaceShip->position = this->spawnPoints[spawnIndex % 32];
-    spaceShip->orientation = glm::quatLookAt(glm::normalize(spaceShip->position), glm::vec3(0.f, 1.f, 0.f));
-    spaceShip->linearVelocity = glm::vec3(0.f);
+    glm::vec3 position = this->spawnPoints[spawnIndex % this->spawnPoints.size()];
+    this->ships.hits[shipIndex] = 0;
+    this->ships.positions[shipIndex] = position;
+    this->ships.orientations[shipIndex] = glm::quatLookAt(glm::normalize(position), glm::vec3(0.f, 1.f, 0.f));
+    this->ships.velocities[shipIndex] = glm::vec3(0.f);
+    this->shipHistory.Reset(this->ships.owners[shipIndex], position);
     this->nextSpaceShipId++;
 
     // send message to others
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    Protocol::Player p_player;
-    this->PackPlayer(spaceShip, p_player);
-    auto outPacket = Protocol::CreateTeleportPlayerS2C(builder, this->currentTimeMillis, &p_player);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_TeleportPlayerS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_RELIABLE);
+    Game::MessageBuilder message;
+    Protocol::QuantizedPlayer p_player;
+    this->PackQuantizedPlayer(shipIndex, p_player);
+    auto outPacket = Protocol::CreateTeleportPlayerS2C(message.builder, this->currentTimeMillis, &p_player);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_TeleportPlayerS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->server->BroadcastData(message, ChannelOf(Protocol::PacketType_TeleportPlayerS2C));
 }
 
 void ServerApp::SendGameState(ENetPeer* client)
 {
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
+    Game::MessageBuilder message;
     
     std::vector<Protocol::Player> p_players;
-    for (auto& spaceShip : this->spaceShips)
+    for (size_t i = 0; i < this->ships.Size(); i++)
     {
         Protocol::Player p_player;
-        this->PackPlayer(spaceShip.second, p_player);
+        this->PackPlayer((uint32)i, p_player);
         p_players.push_back(p_player);
     }
 
     std::vector<Protocol::Laser> p_lasers;
-    for (auto& laser : this->lasers)
+    for (size_t i = 0; i < this->lasers.Size(); i++)
     {
         Protocol::Laser p_laser;
-        this->PackLaser(laser, p_laser);
+        this->PackLaser(i, p_laser);
         p_lasers.push_back(p_laser);
     }
 
-    auto outPacket = Protocol::CreateGameStateS2CDirect(builder, &p_players, &p_lasers);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_GameStateS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->SendData(builder.GetBufferPointer(), builder.GetSize(), client, ENET_PACKET_FLAG_RELIABLE);
+    auto outPacket = Protocol::CreateGameStateS2CDirect(message.builder, &p_players, &p_lasers);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_GameStateS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->server->SendData(message, client, ChannelOf(Protocol::PacketType_GameStateS2C));
 }
 
 void ServerApp::SendClientConnect(ENetPeer* client)
 {
-    uint32 id = spaceShips[client]->id;
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    auto outPacket = Protocol::CreateClientConnectS2C(builder, id, this->currentTimeMillis);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_ClientConnectS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->SendData(builder.GetBufferPointer(), builder.GetSize(), client, ENET_PACKET_FLAG_RELIABLE);
+    uint32 id = this->ships.ids[this->ShipIndex(client)];
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateClientConnectS2C(message.builder, id, this->currentTimeMillis,
+        this->quantizationBounds.worldBound, this->quantizationBounds.maxSpeed, (uint32)std::max(1, Core::CVarReadInt(sv_tickrate)));
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_ClientConnectS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+    this->server->SendData(message, client, ChannelOf(Protocol::PacketType_ClientConnectS2C));
 }
 
-void ServerApp::SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 currentTimeMillis)
+void ServerApp::SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 currentTimeMillis, uint64 rewindMillis)
 {
-    Game::Laser* laser = new Game::Laser(origin, orientation, spaceShipId, currentTimeMillis, currentTimeMillis + this->laserMaxTimeMillis, this->nextLaserId);
-    this->lasers.push_back(laser);
+    size_t index = this->lasers.Add(this->nextLaserId, spaceShipId, origin, orientation, currentTimeMillis, currentTimeMillis + this->laserMaxTimeMillis);
+    this->laserRewinds.push_back(rewindMillis);
     this->nextLaserId++;
 
     // send message to others
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    Protocol::Laser p_laser;
-    this->PackLaser(laser, p_laser);
-    auto outPacket = Protocol::CreateSpawnLaserS2C(builder, &p_laser);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_SpawnLaserS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+    Game::MessageBuilder message;
+    Protocol::QuantizedLaser p_laser;
+    this->PackQuantizedLaser(index, p_laser);
+    auto outPacket = Protocol::CreateSpawnLaserS2C(message.builder, &p_laser);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_SpawnLaserS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+
+    // only clients that could see the laser at some point during its lifetime
+    float laserRange = this->laserSpeed * (float)this->laserMaxTimeMillis * 0.001f;
+    float radius = Core::CVarReadFloat(sv_interestradius) + laserRange;
+    this->SendToNearbyPeers(origin, radius, message, ChannelOf(Protocol::PacketType_SpawnLaserS2C));
 }
 
 void ServerApp::DespawnLaser(size_t index)
 {
-    uint32 id = this->lasers[index]->id;
-    delete this->lasers[index];
-    this->lasers.erase(this->lasers.begin() + index);
+    uint32 id = this->lasers.ids[index];
+    glm::vec3 position = this->lasers.GetCurrentPosition(index, this->currentTimeMillis, this->laserSpeed);
+    this->lasers.Remove(index);
+    this->laserRewinds[index] = this->laserRewinds.back();
+    this->laserRewinds.pop_back();
     
     // send message to others
-    flatbuffers::FlatBufferBuilder builder = flatbuffers::FlatBufferBuilder();
-    auto outPacket = Protocol::CreateDespawnLaserS2C(builder, id);
-    auto packetWrapper = Protocol::CreatePacketWrapper(builder, Protocol::PacketType_DespawnLaserS2C, outPacket.Union());
-    builder.Finish(packetWrapper);
-    this->server->BroadcastData(builder.GetBufferPointer(), builder.GetSize(), ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+    Game::MessageBuilder message;
+    auto outPacket = Protocol::CreateDespawnLaserS2C(message.builder, id);
+    auto packetWrapper = Protocol::CreatePacketWrapper(message.builder, Protocol::PacketType_DespawnLaserS2C, outPacket.Union());
+    message.builder.Finish(packetWrapper);
+
+    // clients farther away can no longer see the laser, and it times out on their side anyway
+    float laserRange = this->laserSpeed * (float)this->laserMaxTimeMillis * 0.001f;
+    float radius = Core::CVarReadFloat(sv_interestradius) + laserRange;
+    this->SendToNearbyPeers(position, radius, message, ChannelOf(Protocol::PacketType_DespawnLaserS2C));
 }
\ No newline at end of file
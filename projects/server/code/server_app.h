@@ -1,16 +1,26 @@
 #pragma once
 
 #include "core/app.h"
+#ifndef SERVER_HEADLESS
 #include "render/window.h"
 #include "render/model.h"
-#include "render/physics.h"
 #include "game/console.h"
+#include "game/spaceship_render.h"
+#endif
+#include "render/physics.h"
 #include "game/network.h"
 #include "game/spaceship.h"
 #include "game/laser.h"
+#include "game/quantize.h"
+#include "game/interest.h"
+#include "game/history.h"
+#include "game/prediction.h"
+#include "game/shipstore.h"
+#include "game/shipintegrate.h"
+#include "game/broadphase.h"
 #include <vector>
+#include <string>
 #include "../build/generated/flat/proto.h"// include directory doesn't want to work in cmake :(
-#include <unordered_map>
 
 class ServerApp : public Core::App
 {
@@ -25,51 +35,107 @@ public:
 	void OnClientConnect(ENetPeer* client);
 	void OnClientDisconnect(ENetPeer* client);
 
+#ifdef SERVER_HEADLESS
+	// stops the headless tick loop, safe to call from a signal handler
+	static void RequestQuit();
+#endif
+
 private:
 	void InitSpawnPoints();
+	void InitAsteroids();
+	bool StartServer(const char* serverIP);
+	bool IsRunning();
+	const std::vector<ENetPeer*>& GetClients() const;
+	// index of the client's ship in the ship store
+	uint32 ShipIndex(ENetPeer* client) const;
+	void Log(const std::string& message);
 
 	// update functions
-	void RenderUI();
+	void Tick(float deltaTime);
 	void UpdateNetwork();
-	void UpdateAndDrawSpaceShips(float deltaTime);
-	void UpdateAndDrawLasers();
+	void UpdateInterest();
+	void UpdateSpaceShips(float deltaTime);
+	void UpdateLasers();
+	void RecordHistory();
+#ifndef SERVER_HEADLESS
+	void RenderUI();
+	void DrawWorld();
+#endif
 
 	// unpack messages from client
-	void PackPlayer(Game::SpaceShip* spaceShip, Protocol::Player& p_player);
-	void PackLaser(Game::Laser* laser, Protocol::Laser& p_laser);
+	void PackPlayer(uint32 shipIndex, Protocol::Player& p_player);
+	void PackLaser(size_t laserIndex, Protocol::Laser& p_laser);
+	void PackQuantizedPlayer(uint32 shipIndex, Protocol::QuantizedPlayer& p_player);
+	void PackQuantizedLaser(size_t laserIndex, Protocol::QuantizedLaser& p_laser);
+	bool PackSnapshot(const Game::Snapshot* baseline, const Game::Snapshot& snapshot, uint32 inputAck, flatbuffers::FlatBufferBuilder& builder);
 	void HandleMessage_Input(ENetPeer* sender, const Protocol::PacketWrapper* packet);
 	void HandleMessage_Text(ENetPeer* sender, const Protocol::PacketWrapper* packet);
 
 	// operations that send data to the clients
 	void SpawnSpaceShip(ENetPeer* client);
-	void UpdateSpaceShipData(ENetPeer* client);
+	void SendSnapshot();
+	void SendToNearbyPeers(const glm::vec3& position, float radius, Game::MessageBuilder& message, Game::Channel channel);
 	void DespawnSpaceShip(ENetPeer* client);
-	void RespawnSpaceShip(ENetPeer* client);
+	void RespawnSpaceShip(uint32 shipIndex);
 	void SendGameState(ENetPeer* client);
 	void SendClientConnect(ENetPeer* client);
-	void SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 currentTimeMillis);
+	void SpawnLaser(const glm::vec3& origin, const glm::quat& orientation, uint32 spaceShipId, uint64 currentTimeMillis, uint64 rewindMillis);
 	void DespawnLaser(size_t index);
 
+#ifndef SERVER_HEADLESS
 	Display::Window* window;
 	Game::Console* console;
+#endif
 	Game::Server* server;
-	uint64 currentTimeMillis;
+	double simulationTimeMillis;// advanced by exactly one tick per tick, see Run
+	uint64 currentTimeMillis;// of the current tick, lasers, history and snapshots are all stamped with it
+	uint64 currentTick;
+	uint32 snapshotSequence;
+	Game::QuantizationBounds quantizationBounds;
+	size_t receiveBacklog;// messages left in the receive queue after the last tick
+	float slowestTickMillis;// since the last snapshot
 
-	std::vector<std::tuple<Render::ModelId, Physics::ColliderId, glm::mat4>> asteroids;
+	std::vector<std::tuple<Physics::ColliderId, glm::mat4>> asteroids;
 
-	std::unordered_map<ENetPeer*, Game::SpaceShip*> spaceShips;
-	Render::ModelId spaceShipModel;
+	Game::ShipStore ships;
+	std::vector<Game::ShipHandle> shipHandles;// indexed by peer slot, invalid while the slot is free
+	std::vector<Game::InputQueue> inputQueues;// indexed by peer slot, predicted inputs waiting for their tick
 	uint32 nextSpaceShipId;
 	std::vector<glm::vec3> spawnPoints;
 	float spaceShipCollisionRadiusSquared;
+	Game::CollisionGrid collisionGrid;// rebuilt every tick, indexed like the ship store
+	std::vector<Game::CollisionPair> collisionPairs;
 
-	std::vector<Game::Laser*> lasers;
-	Render::ModelId laserModel;
+	// lag compensation, lasers hit ships where their shooter saw them
+	Game::TransformHistory shipHistory;
+	std::vector<uint64> viewDelays;// indexed by peer slot, how far behind the server each client's view is in ms
+	std::vector<Game::InterestEntry> hitCandidates;
+
+	// area of interest, rebuilt every tick
+	Game::InterestGrid interestGrid;// indexed like the ship store
+	std::vector<std::vector<Game::InterestEntry>> relevantSets;// indexed by peer slot
+	std::vector<std::vector<Game::InterestPriority>> sendPriorities;// indexed by peer slot, sorted by id
+
+	Game::LaserStore lasers;
+	std::vector<uint64> laserRewinds;// indexed like the laser store, the shooter's view delay when it fired
 	uint32 nextLaserId;
 	uint64 laserMaxTimeMillis;
 	float laserSpeed;
 	float laserCooldown;
+	// swept collision, rebuilt every tick and indexed like the laser store
+	uint64 lastLaserUpdateMillis;
+	std::vector<glm::vec3> laserSweepStarts;
+	std::vector<float> laserSweepLengths;
+	std::vector<uint8> laserHits;// LaserHit
+
+#ifndef SERVER_HEADLESS
+	// render state, only present in the windowed server
+	std::vector<Render::ModelId> asteroidModels;
+	std::vector<Game::SpaceShipRender*> spaceShipRenders;// indexed by peer slot
+	Render::ModelId spaceShipModel;
+	Render::ModelId laserModel;
 
 	bool spectate;
 	size_t spectateIndex;
-};
\ No newline at end of file
+#endif
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdio>
+
+// counts failed checks, a test returns the count from main so that ctest sees any failure
+static int failedChecks = 0;
+
+#define CHECK(exp) { if (!(exp)) { failedChecks++; std::printf("%s(%d): failed: %s\n", __FILE__, __LINE__, #exp); } }
+#define CHECK_FMT(exp, msg, ...) { if (!(exp)) { failedChecks++; std::printf("%s(%d): failed: %s, " msg "\n", __FILE__, __LINE__, #exp, __VA_ARGS__); } }
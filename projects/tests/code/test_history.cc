@@ -0,0 +1,140 @@
+#include "config.h"
+#include "game/history.h"
+#include "check.h"
+#include <cmath>
+
+// server time of a tick, uneven so that bisection can't get away with dividing by a fixed tick length
+static uint64 TimeOf(uint64 tick)
+{
+	return tick * 16 + (tick % 3) * 5;
+}
+
+// where slot is at a tick while it moves in a straight line
+static glm::vec3 PathOf(uint32 slot, uint64 tick)
+{
+	return glm::vec3((float)tick, (float)slot * 100.f, -2.f * (float)tick);
+}
+
+static bool Near(const glm::vec3& a, const glm::vec3& b)
+{
+	return glm::length(a - b) < 1e-4f;
+}
+
+static void Run(Game::TransformHistory& history, uint32 numSlots, uint64 from, uint64 to)
+{
+	for (uint64 tick = from; tick <= to; tick++)
+	{
+		history.BeginTick(tick, TimeOf(tick));
+		for (uint32 slot = 0; slot < numSlots; slot++)
+			history.Record(slot, PathOf(slot, tick));
+	}
+}
+
+static void TestCapacity()
+{
+	Game::TransformHistory history;
+	history.Resize(1, 5, 0);
+	CHECK(history.GetCapacity() == 8);
+	history.Resize(1, 8, 0);
+	CHECK(history.GetCapacity() == 8);
+	history.Resize(1, 9, 0);
+	CHECK(history.GetCapacity() == 16);
+	history.Resize(1, 1, 0);
+	CHECK(history.GetCapacity() == 1);
+}
+
+static void TestTickAt()
+{
+	Game::TransformHistory history;
+	history.Resize(2, 16, 100);
+	Run(history, 2, 100, 110);
+
+	// every tick time maps to its own tick, and times in between to the fraction between the two ticks around it
+	for (uint64 tick = 100; tick <= 110; tick++)
+		CHECK_FMT(history.TickAt(TimeOf(tick)) == (double)tick, "tick %llu", (unsigned long long)tick);
+	for (uint64 tick = 100; tick < 110; tick++)
+	{
+		uint64 time = TimeOf(tick) + (TimeOf(tick + 1) - TimeOf(tick)) / 2;
+		double expected = (double)tick + (double)(time - TimeOf(tick)) / (double)(TimeOf(tick + 1) - TimeOf(tick));
+		double result = history.TickAt(time);
+		CHECK_FMT(std::abs(result - expected) < 1e-9, "tick %llu gave %g", (unsigned long long)tick, result);
+	}
+
+	// clamped to the ticks recorded since Resize
+	CHECK(history.TickAt(0) == 100.0);
+	CHECK(history.TickAt(TimeOf(100) - 1) == 100.0);
+	CHECK(history.TickAt(TimeOf(110) + 1) == 110.0);
+	CHECK(history.TickAt(~0ull) == 110.0);
+}
+
+static void TestWraparound()
+{
+	Game::TransformHistory history;
+	history.Resize(3, 8, 0);
+	Run(history, 3, 0, 29);
+
+	// only the last capacity ticks are kept, anything older clamps to the oldest of them
+	uint64 oldest = 29 - history.GetCapacity() + 1;
+	CHECK(history.TickAt(0) == (double)oldest);
+	CHECK(history.TickAt(TimeOf(oldest)) == (double)oldest);
+	CHECK(history.TickAt(TimeOf(oldest + 1)) == (double)(oldest + 1));
+	CHECK(history.TickAt(TimeOf(29)) == 29.0);
+
+	for (uint32 slot = 0; slot < 3; slot++)
+	{
+		for (uint64 tick = oldest; tick <= 29; tick++)
+			CHECK_FMT(Near(history.PositionAt(slot, (double)tick), PathOf(slot, tick)), "slot %u tick %llu", slot, (unsigned long long)tick);
+
+		// between two kept ticks the path is interpolated, also across the end of the ring
+		for (uint64 tick = oldest; tick < 29; tick++)
+		{
+			glm::vec3 expected = glm::mix(PathOf(slot, tick), PathOf(slot, tick + 1), 0.25f);
+			CHECK_FMT(Near(history.PositionAt(slot, (double)tick + 0.25), expected), "slot %u tick %llu", slot, (unsigned long long)tick);
+		}
+
+		CHECK(Near(history.PositionAt(slot, 0.0), PathOf(slot, oldest)));
+		CHECK(Near(history.PositionAt(slot, 1000.0), PathOf(slot, 29)));
+	}
+}
+
+static void TestReset()
+{
+	Game::TransformHistory history;
+	history.Resize(2, 16, 0);
+	Run(history, 2, 0, 9);
+
+	// slot 1 teleports at tick 10 and moves on from there, slot 0 keeps going
+	glm::vec3 teleport(500.f, -500.f, 500.f);
+	history.BeginTick(10, TimeOf(10));
+	history.Record(0, PathOf(0, 10));
+	history.Reset(1, teleport);
+	for (uint64 tick = 11; tick <= 14; tick++)
+	{
+		history.BeginTick(tick, TimeOf(tick));
+		history.Record(0, PathOf(0, tick));
+		history.Record(1, teleport + glm::vec3((float)(tick - 10), 0.f, 0.f));
+	}
+
+	// before the teleport slot 1 is where it teleported to, never somewhere between there and where it was
+	for (double tick : { 0.0, 5.0, 9.0, 9.5, 9.99, 10.0 })
+		CHECK_FMT(Near(history.PositionAt(1, tick), teleport), "tick %g", tick);
+
+	CHECK(Near(history.PositionAt(1, 10.5), teleport + glm::vec3(0.5f, 0.f, 0.f)));
+	CHECK(Near(history.PositionAt(1, 14.0), teleport + glm::vec3(4.f, 0.f, 0.f)));
+
+	// the other slot is untouched
+	CHECK(Near(history.PositionAt(0, 9.5), glm::mix(PathOf(0, 9), PathOf(0, 10), 0.5f)));
+	CHECK(Near(history.PositionAt(0, 2.0), PathOf(0, 2)));
+}
+
+int
+main()
+{
+	TestCapacity();
+	TestTickAt();
+	TestWraparound();
+	TestReset();
+
+	std::printf("test_history: %d failed\n", failedChecks);
+	return failedChecks;
+}
@@ -0,0 +1,214 @@
+#include "config.h"
+#include "game/laser.h"
+#include "check.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const uint32 numLasers = 9;
+
+// every field is made from the id, so that a laser moved by a removal can be told apart from its neighbours
+static void AddLaser(Game::LaserStore& store, uint32 id)
+{
+	glm::quat orientation = glm::angleAxis(0.1f * (float)id, glm::vec3(0.f, 1.f, 0.f));
+	store.Add(id, id + 1000, glm::vec3((float)id, 0.f, 0.f), orientation, id * 10, id * 10 + 5000);
+}
+
+static void CheckLaser(const Game::LaserStore& store, uint32 id)
+{
+	size_t index = store.Find(id);
+	CHECK_FMT(index < store.Size(), "laser %u missing", id);
+	if (index >= store.Size())
+		return;
+
+	CHECK_FMT(store.ids[index] == id, "laser %u found at the index of %u", id, store.ids[index]);
+	CHECK_FMT(store.spaceShipIds[index] == id + 1000, "laser %u", id);
+	CHECK_FMT(store.origins[index].x == (float)id, "laser %u", id);
+	CHECK_FMT(store.spawnTimes[index] == id * 10 && store.despawnTimes[index] == id * 10 + 5000, "laser %u", id);
+	glm::quat orientation = glm::angleAxis(0.1f * (float)id, glm::vec3(0.f, 1.f, 0.f));
+	CHECK_FMT(store.orientations[index] == orientation, "laser %u", id);
+	CHECK_FMT(glm::length(store.directions[index] - orientation * glm::vec3(0.f, 0.f, 1.f)) < 1e-6f, "laser %u", id);
+}
+
+static void TestRemove()
+{
+	Game::LaserStore store;
+	for (uint32 id = 1; id <= numLasers; id++)
+		AddLaser(store, id);
+
+	std::vector<uint32> removed;
+	auto remove = [&](size_t index)
+	{
+		removed.push_back(store.ids[index]);
+		store.Remove(index);
+	};
+
+	// the first, one in the middle and the last, then every laser left has to be found where it now is
+	remove(0);
+	remove(store.Size() / 2);
+	remove(store.Size() - 1);
+	CHECK(store.Size() == numLasers - 3);
+
+	for (uint32 id = 1; id <= numLasers; id++)
+	{
+		if (std::find(removed.begin(), removed.end(), id) != removed.end())
+		{
+			CHECK_FMT(store.Find(id) == store.Size(), "removed laser %u still found", id);
+		}
+		else
+			CheckLaser(store, id);
+	}
+
+	// removing everything from the front keeps moving the last laser into place
+	while (store.Size() > 0)
+	{
+		uint32 id = store.ids[0];
+		store.Remove(0);
+		CHECK(store.Find(id) == store.Size());
+		for (size_t i = 0; i < store.Size(); i++)
+			CheckLaser(store, store.ids[i]);
+	}
+
+	// and a store that was emptied or cleared starts over
+	AddLaser(store, 42);
+	CheckLaser(store, 42);
+	store.Clear();
+	CHECK(store.Size() == 0 && store.Find(42) == 0);
+}
+
+static void TestSegmentHitsSphere()
+{
+	const glm::vec3 start(0.f);
+	const glm::vec3 direction(1.f, 0.f, 0.f);
+	const float radius = 2.f;
+	const float radiusSquared = radius * radius;
+
+	// passing through, just grazing, and just missing the side of the sphere
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(5.f, 1.f, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(5.f, radius, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(5.f, 0.f, -radius), radiusSquared));
+	CHECK(!Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(5.f, radius * 1.001f, 0.f), radiusSquared));
+
+	// starting inside the sphere, also pointing away from its center
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(0.5f, 0.5f, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(-1.f, 0.f, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, -direction, 10.f, glm::vec3(1.f, 0.f, 0.f), radiusSquared));
+
+	// a zero length segment is only its start
+	CHECK(Game::SegmentHitsSphere(start, direction, 0.f, glm::vec3(0.f, 1.f, 1.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 0.f, glm::vec3(-radius, 0.f, 0.f), radiusSquared));
+	CHECK(!Game::SegmentHitsSphere(start, direction, 0.f, glm::vec3(radius * 1.001f, 0.f, 0.f), radiusSquared));
+
+	// the sphere just past either end of the segment, and touching the end
+	CHECK(!Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(10.f + radius * 1.001f, 0.f, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(10.f + radius, 0.f, 0.f), radiusSquared));
+	CHECK(Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(10.f + radius * 0.999f, 0.f, 0.f), radiusSquared));
+	CHECK(!Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(-radius * 1.001f, 0.f, 0.f), radiusSquared));
+	CHECK(!Game::SegmentHitsSphere(start, direction, 10.f, glm::vec3(11.5f, 1.5f, 0.f), radiusSquared));
+}
+
+// distance from a point to the segment, in doubles so that it can tell which spheres are too close to call
+static double Distance(const glm::vec3& start, const glm::vec3& direction, float length, const glm::vec3& point)
+{
+	glm::dvec3 diff = glm::dvec3(point) - glm::dvec3(start);
+	double along = glm::clamp(glm::dot(diff, glm::dvec3(direction)), 0.0, (double)length);
+	return glm::length(diff - glm::dvec3(direction) * along);
+}
+
+static void TestSweeps()
+{
+	const float velocity = 150.f;
+	const float radius = 2.f;
+	const uint64 from = 1000;
+	const uint64 to = 2000;
+	const uint64 step = 16;
+
+	// lasers that spawned before, during and right at the end of the sweep
+	Game::LaserStore store;
+	uint64 spawnTimes[] = { 0, 500, 1000, 1250, 1999, 2000 };
+	for (uint32 i = 0; i < 6; i++)
+	{
+		glm::quat orientation = glm::angleAxis(0.7f * (float)i, glm::normalize(glm::vec3(1.f, 2.f, 3.f)));
+		store.Add(i, 0, glm::vec3(10.f * (float)i, -5.f, 3.f), orientation, spawnTimes[i], spawnTimes[i] + 3000);
+	}
+
+	std::vector<glm::vec3> longStarts;
+	std::vector<float> longLengths;
+	store.GetSweeps(from, to, velocity, longStarts, longLengths);
+	CHECK(longStarts.size() == store.Size() && longLengths.size() == store.Size());
+
+	// one long sweep starts where the laser was, or where it spawned, and ends where it is
+	for (size_t i = 0; i < store.Size(); i++)
+	{
+		uint64 spawn = glm::max(from, spawnTimes[i]);
+		CHECK_FMT(glm::length(longStarts[i] - store.GetCurrentPosition(i, spawn, velocity)) < 1e-3f, "laser %zu", i);
+		CHECK_FMT(glm::abs(longLengths[i] - 0.001f * (float)(to - spawn) * velocity) < 1e-3f, "laser %zu", i);
+		glm::vec3 end = longStarts[i] + store.directions[i] * longLengths[i];
+		CHECK_FMT(glm::length(end - store.GetCurrentPosition(i, to, velocity)) < 1e-3f, "laser %zu", i);
+	}
+
+	// many short sweeps over the same time follow on from each other and cover the same segment
+	std::vector<std::vector<glm::vec3>> shortStarts;
+	std::vector<std::vector<float>> shortLengths;
+	for (uint64 time = from; time < to; time += step)
+	{
+		shortStarts.emplace_back();
+		shortLengths.emplace_back();
+		store.GetSweeps(time, glm::min(time + step, to), velocity, shortStarts.back(), shortLengths.back());
+	}
+
+	for (size_t i = 0; i < store.Size(); i++)
+	{
+		float total = 0.f;
+		CHECK_FMT(glm::length(shortStarts.front()[i] - longStarts[i]) < 1e-3f, "laser %zu", i);
+		for (size_t s = 0; s < shortStarts.size(); s++)
+		{
+			CHECK(shortLengths[s][i] >= 0.f);
+			total += shortLengths[s][i];
+			if (s + 1 < shortStarts.size())
+			{
+				glm::vec3 end = shortStarts[s][i] + store.directions[i] * shortLengths[s][i];
+				CHECK_FMT(glm::length(end - shortStarts[s + 1][i]) < 1e-3f, "laser %zu sweep %zu", i, s);
+			}
+		}
+		CHECK_FMT(glm::abs(total - longLengths[i]) < 1e-2f, "laser %zu: %g against %g", i, total, longLengths[i]);
+
+		// any sphere the long sweep hits one of the short ones does, and no other
+		uint32 numHits = 0;
+		for (float along = -5.f; along <= longLengths[i] + 5.f; along += 0.37f)
+		{
+			for (float side : { 0.f, 0.5f, 1.5f, 2.5f })
+			{
+				glm::vec3 perpendicular = glm::normalize(glm::cross(store.directions[i], glm::vec3(0.f, 1.f, 0.f)));
+				glm::vec3 center = longStarts[i] + store.directions[i] * along + perpendicular * (side * radius);
+				if (std::abs(Distance(longStarts[i], store.directions[i], longLengths[i], center) - (double)radius) < 1e-2)
+					continue;
+
+				bool longHit = Game::SegmentHitsSphere(longStarts[i], store.directions[i], longLengths[i], center, radius * radius);
+				bool shortHit = false;
+				for (size_t s = 0; s < shortStarts.size() && !shortHit; s++)
+					shortHit = Game::SegmentHitsSphere(shortStarts[s][i], store.directions[i], shortLengths[s][i], center, radius * radius);
+
+				CHECK_FMT(longHit == shortHit, "laser %zu, %g along and %g to the side", i, along, side);
+				numHits += longHit ? 1 : 0;
+			}
+		}
+		CHECK_FMT(numHits > 0, "laser %zu", i);
+	}
+
+	// a sweep that ends before the laser spawned has no length
+	store.GetSweeps(0, 400, velocity, longStarts, longLengths);
+	CHECK(longLengths[1] == 0.f && longLengths[5] == 0.f);
+	CHECK(glm::length(longStarts[5] - store.origins[5]) < 1e-6f);
+}
+
+int
+main()
+{
+	TestRemove();
+	TestSegmentHitsSphere();
+	TestSweeps();
+
+	std::printf("test_laser: %d failed\n", failedChecks);
+	return failedChecks;
+}
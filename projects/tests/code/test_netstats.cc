@@ -0,0 +1,139 @@
+#include "config.h"
+#include "game/netstats.h"
+#include "../build/generated/flat/proto.h"// include directory doesn't want to work in cmake :(
+#include "check.h"
+#include <vector>
+
+// a finished PacketWrapper around packet, the way the apps send one
+static std::vector<uint8> Finish(flatbuffers::FlatBufferBuilder& builder, Protocol::PacketType type, flatbuffers::Offset<void> packet)
+{
+	builder.Finish(Protocol::CreatePacketWrapper(builder, type, packet));
+	return std::vector<uint8>(builder.GetBufferPointer(), builder.GetBufferPointer() + builder.GetSize());
+}
+
+static std::vector<std::vector<uint8>> RealMessages(std::vector<uint8>& outTypes)
+{
+	std::vector<std::vector<uint8>> messages;
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		auto packet = Protocol::CreateInputC2S(builder, 1234, 0x1f, 7, 1200, 42);
+		messages.push_back(Finish(builder, Protocol::PacketType_InputC2S, packet.Union()));
+		outTypes.push_back(Protocol::PacketType_InputC2S);
+	}
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		auto packet = Protocol::CreateTextC2SDirect(builder, "hello");
+		messages.push_back(Finish(builder, Protocol::PacketType_TextC2S, packet.Union()));
+		outTypes.push_back(Protocol::PacketType_TextC2S);
+	}
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		auto packet = Protocol::CreateDespawnLaserS2C(builder, 99);
+		messages.push_back(Finish(builder, Protocol::PacketType_DespawnLaserS2C, packet.Union()));
+		outTypes.push_back(Protocol::PacketType_DespawnLaserS2C);
+	}
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		std::vector<flatbuffers::Offset<Protocol::PlayerDelta>> players;
+		for (uint32 i = 0; i < 16; i++)
+			players.push_back(Protocol::CreatePlayerDelta(builder, i));
+		std::vector<uint32> removed = { 3, 5 };
+		auto packet = Protocol::CreateWorldSnapshotS2CDirect(builder, 5000, 12, 10, &players, 1.5f, 40, &removed);
+		messages.push_back(Finish(builder, Protocol::PacketType_WorldSnapshotS2C, packet.Union()));
+		outTypes.push_back(Protocol::PacketType_WorldSnapshotS2C);
+	}
+	return messages;
+}
+
+static uint8 TypeOfPrefix(const std::vector<uint8>& message, size_t size)
+{
+	// copied so that a read past size runs off the end of the allocation
+	std::vector<uint8> prefix(message.begin(), message.begin() + size);
+	return Game::MessageTypeOf(prefix.data(), prefix.size());
+}
+
+static void TestRealMessages()
+{
+	std::vector<uint8> types;
+	std::vector<std::vector<uint8>> messages = RealMessages(types);
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		CHECK_FMT(TypeOfPrefix(messages[i], messages[i].size()) == types[i], "type %u", (uint32)types[i]);
+
+		// a truncated buffer is 0 until it is long enough to hold the type, and the type after
+		bool found = false;
+		for (size_t size = 0; size < messages[i].size(); size++)
+		{
+			uint8 type = TypeOfPrefix(messages[i], size);
+			CHECK_FMT(type == 0 || type == types[i], "type %u truncated to %zu bytes gave %u", (uint32)types[i], size, (uint32)type);
+			CHECK_FMT(!found || type == types[i], "type %u truncated to %zu bytes gave %u", (uint32)types[i], size, (uint32)type);
+			found = found || type != 0;
+		}
+		CHECK(TypeOfPrefix(messages[i], 0) == 0);
+		CHECK(TypeOfPrefix(messages[i], 3) == 0);
+	}
+
+	// every type the union has, around an empty packet
+	for (uint8 type = Protocol::PacketType_MIN + 1; type <= Protocol::PacketType_MAX; type++)
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		auto packet = Protocol::CreateDespawnPlayerS2C(builder);
+		std::vector<uint8> message = Finish(builder, (Protocol::PacketType)type, packet.Union());
+		CHECK_FMT(Game::MessageTypeOf(message.data(), message.size()) == type, "type %u", (uint32)type);
+	}
+}
+
+static void TestDefaultedType()
+{
+	// the builder leaves a field at its default out of the vtable
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		std::vector<uint8> message = Finish(builder, Protocol::PacketType_NONE, 0);
+		CHECK(Game::MessageTypeOf(message.data(), message.size()) == 0);
+	}
+
+	// forced into the buffer it is read as 0 as well
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		builder.ForceDefaults(true);
+		std::vector<uint8> message = Finish(builder, Protocol::PacketType_NONE, 0);
+		CHECK(Game::MessageTypeOf(message.data(), message.size()) == 0);
+	}
+
+	// a table without any fields has a vtable too short to hold the type
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		builder.Finish(flatbuffers::Offset<void>(builder.EndTable(builder.StartTable())));
+		std::vector<uint8> message(builder.GetBufferPointer(), builder.GetBufferPointer() + builder.GetSize());
+		CHECK(Game::MessageTypeOf(message.data(), message.size()) == 0);
+	}
+
+	// a packet with the type left out but the packet itself present
+	{
+		flatbuffers::FlatBufferBuilder builder;
+		auto packet = Protocol::CreateDespawnPlayerS2C(builder, 5);
+		std::vector<uint8> message = Finish(builder, Protocol::PacketType_NONE, packet.Union());
+		CHECK(Game::MessageTypeOf(message.data(), message.size()) == 0);
+	}
+}
+
+static void TestGarbage()
+{
+	// offsets pointing past the end of the buffer
+	std::vector<uint8> bytes(16, 0xff);
+	CHECK(Game::MessageTypeOf(bytes.data(), bytes.size()) == 0);
+
+	std::vector<uint8> zeros(16, 0);
+	CHECK(Game::MessageTypeOf(zeros.data(), zeros.size()) == 0);
+}
+
+int
+main()
+{
+	TestRealMessages();
+	TestDefaultedType();
+	TestGarbage();
+
+	std::printf("test_netstats: %d failed\n", failedChecks);
+	return failedChecks;
+}
@@ -0,0 +1,199 @@
+#include "config.h"
+#include "game/prediction.h"
+#include "check.h"
+#include <random>
+#include <vector>
+
+static const float deltaTime = 1.f / 60.f;
+
+static Game::InputData InputOf(uint16 bits, uint64 timeStamp)
+{
+	Game::InputData input;
+	input.FromBits(bits);
+	input.timeStamp = timeStamp;
+	return input;
+}
+
+// steering that changes every few ticks, thrusting most of the time
+static std::vector<Game::InputData> Inputs(uint32 numTicks)
+{
+	std::mt19937 rng(7);
+	std::vector<Game::InputData> inputs;
+	uint16 bits = 0;
+	for (uint32 i = 0; i < numTicks; i++)
+	{
+		if (i % 5 == 0)
+			bits = (uint16)(rng() & 0x1ff) | 1;
+		inputs.push_back(InputOf(bits, i));
+	}
+	return inputs;
+}
+
+static bool Equal(const Game::SpaceShipState& a, const Game::SpaceShipState& b, float tolerance)
+{
+	return glm::length(a.position - b.position) <= tolerance &&
+		glm::length(a.linearVelocity - b.linearVelocity) <= tolerance &&
+		glm::abs(glm::dot(a.orientation, b.orientation)) >= 1.f - tolerance &&
+		glm::abs(a.currentSpeed - b.currentSpeed) <= tolerance &&
+		glm::abs(a.rotationZ - b.rotationZ) <= tolerance &&
+		glm::abs(a.rotXSmooth - b.rotXSmooth) <= tolerance &&
+		glm::abs(a.rotYSmooth - b.rotYSmooth) <= tolerance &&
+		glm::abs(a.rotZSmooth - b.rotZSmooth) <= tolerance;
+}
+
+static glm::vec3 DrawnPosition(const Game::SpaceShip& spaceShip)
+{
+	return glm::vec3(spaceShip.transform[3]);
+}
+
+static void TestInputQueueOrder()
+{
+	Game::InputQueue queue;
+	Game::InputData input;
+	CHECK(!queue.Pop(input));
+	CHECK(queue.GetProcessedSequence() == 0);
+
+	queue.Push(1, InputOf(1, 100));
+	queue.Push(2, InputOf(2, 200));
+	queue.Push(2, InputOf(3, 300));// twice
+	queue.Push(1, InputOf(4, 400));// late
+	queue.Push(4, InputOf(5, 500));
+	queue.Push(3, InputOf(6, 600));// arrived after 4 was queued
+
+	uint32 expectedSequences[] = { 1, 2, 4 };
+	uint64 expectedTimes[] = { 100, 200, 500 };
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(queue.Pop(input));
+		CHECK(input.timeStamp == expectedTimes[i]);
+		CHECK(queue.GetProcessedSequence() == expectedSequences[i]);
+	}
+
+	// running dry keeps the last sequence, and one already used stays ignored
+	CHECK(!queue.Pop(input));
+	CHECK(queue.GetProcessedSequence() == 4);
+	queue.Push(4, InputOf(7, 700));
+	CHECK(!queue.Pop(input));
+
+	queue.Clear();
+	CHECK(queue.GetProcessedSequence() == 0);
+	queue.Push(1, InputOf(8, 800));
+	CHECK(queue.Pop(input) && input.timeStamp == 800);
+}
+
+static void TestInputQueueCapacity()
+{
+	Game::InputQueue queue;
+	const uint32 extra = 3;
+	for (uint32 sequence = 1; sequence <= Game::InputQueue::capacity + extra; sequence++)
+		queue.Push(sequence, InputOf(0, sequence));
+
+	// the oldest were dropped to make room
+	Game::InputData input;
+	for (uint32 sequence = 1 + extra; sequence <= Game::InputQueue::capacity + extra; sequence++)
+	{
+		CHECK(queue.Pop(input));
+		CHECK_FMT(input.timeStamp == sequence && queue.GetProcessedSequence() == sequence, "sequence %u", sequence);
+	}
+	CHECK(!queue.Pop(input));
+}
+
+// a server that used every input the client predicted, optionally pushed off course after one of them
+static std::vector<Game::SpaceShipState> ServerStates(const std::vector<Game::InputData>& inputs, uint32 pushAfter, const glm::vec3& push)
+{
+	Game::SpaceShip server;
+	std::vector<Game::SpaceShipState> states;
+	for (uint32 i = 0; i < inputs.size(); i++)
+	{
+		server.inputData = inputs[i];
+		server.ServerUpdate(deltaTime);
+		if (i + 1 == pushAfter)
+			server.position += push;
+		states.push_back(Game::SpaceShipState::Capture(server));
+	}
+	return states;
+}
+
+static void TestReconcileWithoutError()
+{
+	std::vector<Game::InputData> inputs = Inputs(40);
+	std::vector<Game::SpaceShipState> server = ServerStates(inputs, 0, glm::vec3(0.f));
+
+	Game::SpaceShip client;
+	Game::ShipPredictor predictor;
+	std::vector<uint32> sequences;
+	for (const Game::InputData& input : inputs)
+		sequences.push_back(predictor.Predict(client, input, deltaTime));
+	CHECK(sequences.front() == 1 && sequences.back() == 40);
+
+	Game::SpaceShipState predicted = Game::SpaceShipState::Capture(client);
+	for (uint32 acked : { 10u, 25u, 40u })
+	{
+		const Game::SpaceShipState& state = server[acked - 1];
+		predictor.Reconcile(client, acked, state.position, state.linearVelocity, state.orientation, deltaTime, 0.01f, 100.f);
+		CHECK_FMT(Equal(Game::SpaceShipState::Capture(client), predicted, 0.f), "acked %u", acked);
+	}
+
+	// nothing to ease out either
+	predictor.Smooth(client, deltaTime, 10.f);
+	CHECK(DrawnPosition(client) == predicted.position);
+}
+
+static void TestReplayAfterCorrection()
+{
+	const uint32 numTicks = 60;
+	const uint32 pushAfter = 20;
+	const glm::vec3 push(3.f, -1.f, 2.f);
+	std::vector<Game::InputData> inputs = Inputs(numTicks);
+	std::vector<Game::SpaceShipState> server = ServerStates(inputs, pushAfter, push);
+
+	// the client didn't see the push coming and predicted every input on its own
+	Game::SpaceShip client;
+	Game::ShipPredictor predictor;
+	for (const Game::InputData& input : inputs)
+		predictor.Predict(client, input, deltaTime);
+	glm::vec3 predictedPosition = client.position;
+	CHECK(!Equal(Game::SpaceShipState::Capture(client), server.back(), 0.1f));
+
+	// replaying the inputs after the push from the server's state lands where the server is
+	const Game::SpaceShipState& acked = server[pushAfter - 1];
+	predictor.Reconcile(client, pushAfter, acked.position, acked.linearVelocity, acked.orientation, deltaTime, 0.01f, 100.f);
+	CHECK_FMT(Equal(Game::SpaceShipState::Capture(client), server.back(), 1e-4f), "off by %g", glm::length(client.position - server.back().position));
+
+	// an older acknowledgement than the one last used changes nothing
+	Game::SpaceShipState replayed = Game::SpaceShipState::Capture(client);
+	predictor.Reconcile(client, pushAfter - 5, server[pushAfter - 6].position, server[pushAfter - 6].linearVelocity, server[pushAfter - 6].orientation,
+		deltaTime, 0.01f, 100.f);
+	CHECK(Equal(Game::SpaceShipState::Capture(client), replayed, 0.f));
+
+	// the correction is drawn from where the ship was predicted and eased out
+	predictor.Smooth(client, 0.f, 10.f);
+	CHECK(glm::length(DrawnPosition(client) - predictedPosition) < 1e-4f);
+	for (int i = 0; i < 120; i++)
+		predictor.Smooth(client, deltaTime, 10.f);
+	CHECK(glm::length(DrawnPosition(client) - client.position) < 1e-3f);
+
+	// and later ticks keep predicting from the corrected state
+	Game::SpaceShip reference;
+	server.back().Apply(reference);
+	Game::InputData input = InputOf(0x1f, numTicks);
+	for (int i = 0; i < 10; i++)
+	{
+		predictor.Predict(client, input, deltaTime);
+		reference.inputData = input;
+		reference.ServerUpdate(deltaTime);
+	}
+	CHECK(Equal(Game::SpaceShipState::Capture(client), Game::SpaceShipState::Capture(reference), 1e-4f));
+}
+
+int
+main()
+{
+	TestInputQueueOrder();
+	TestInputQueueCapacity();
+	TestReconcileWithoutError();
+	TestReplayAfterCorrection();
+
+	std::printf("test_prediction: %d failed\n", failedChecks);
+	return failedChecks;
+}
@@ -0,0 +1,153 @@
+#include "config.h"
+#include "game/quantize.h"
+#include "check.h"
+#include <cmath>
+#include <random>
+
+// half a step of a signed field with bits bits over [-bound, bound], the most a round trip may be off by
+static float HalfStep(float bound, uint32 bits)
+{
+	return 0.5f * bound / (float)((1 << (bits - 1)) - 1);
+}
+
+// every representable step and the points halfway between them, plus the bounds
+static std::vector<float> SweepValues(float bound, uint32 bits)
+{
+	std::vector<float> values;
+	int32 maxSteps = (1 << (bits - 1)) - 1;
+	for (int32 step = -maxSteps; step <= maxSteps; step++)
+	{
+		values.push_back(bound * (float)step / (float)maxSteps);
+		if (step < maxSteps)
+			values.push_back(bound * ((float)step + 0.5f) / (float)maxSteps);
+		if (step > -maxSteps)
+			values.push_back(bound * ((float)step - 0.49f) / (float)maxSteps);
+	}
+	values.push_back(0.f);
+	values.push_back(-0.f);
+	values.push_back(bound);
+	values.push_back(-bound);
+	values.push_back(std::nextafter(bound, 0.f));
+	values.push_back(std::nextafter(-bound, 0.f));
+	return values;
+}
+
+static void TestPosition(float worldBound)
+{
+	// a small float error on top of half a step, the division and multiplication each round once
+	float tolerance = HalfStep(worldBound, 16) + worldBound * 4e-7f;
+	float maxError = 0.f;
+	for (float value : SweepValues(worldBound, 16))
+	{
+		glm::vec3 position(value, -value, value * 0.5f);
+		glm::vec3 result = Game::DequantizePosition(Game::QuantizePosition(position, worldBound), worldBound);
+		maxError = glm::max(maxError, glm::max(glm::abs(result.x - position.x), glm::max(glm::abs(result.y - position.y), glm::abs(result.z - position.z))));
+	}
+	CHECK_FMT(maxError <= tolerance, "bound %g max error %g tolerance %g", worldBound, maxError, tolerance);
+
+	// the bounds and zero come back exactly, anything beyond is clamped onto the bound
+	glm::vec3 edges = Game::DequantizePosition(Game::QuantizePosition(glm::vec3(worldBound, -worldBound, 0.f), worldBound), worldBound);
+	CHECK(edges == glm::vec3(worldBound, -worldBound, 0.f));
+	glm::vec3 clamped = Game::DequantizePosition(Game::QuantizePosition(glm::vec3(worldBound * 3.f, -worldBound * 3.f, 0.f), worldBound), worldBound);
+	CHECK(clamped == glm::vec3(worldBound, -worldBound, 0.f));
+}
+
+static void TestVelocity(float maxSpeed)
+{
+	float toleranceXY = HalfStep(maxSpeed, 11) + maxSpeed * 4e-7f;
+	float toleranceZ = HalfStep(maxSpeed, 10) + maxSpeed * 4e-7f;
+	glm::vec3 maxError(0.f);
+	for (float value : SweepValues(maxSpeed, 10))
+	{
+		// each field gets its own value so that a field bleeding into its neighbour shows up
+		glm::vec3 velocity(value, -value * 0.75f, -value);
+		glm::vec3 result = Game::DequantizeVelocity(Game::QuantizeVelocity(velocity, maxSpeed), maxSpeed);
+		maxError = glm::max(maxError, glm::abs(result - velocity));
+	}
+	for (float value : SweepValues(maxSpeed, 11))
+	{
+		glm::vec3 velocity(-value, value, 0.f);
+		glm::vec3 result = Game::DequantizeVelocity(Game::QuantizeVelocity(velocity, maxSpeed), maxSpeed);
+		maxError = glm::max(maxError, glm::abs(result - velocity));
+	}
+	CHECK_FMT(maxError.x <= toleranceXY && maxError.y <= toleranceXY, "max speed %g max error %g %g tolerance %g", maxSpeed, maxError.x, maxError.y, toleranceXY);
+	CHECK_FMT(maxError.z <= toleranceZ, "max speed %g max error %g tolerance %g", maxSpeed, maxError.z, toleranceZ);
+
+	glm::vec3 edges = Game::DequantizeVelocity(Game::QuantizeVelocity(glm::vec3(maxSpeed, -maxSpeed, maxSpeed), maxSpeed), maxSpeed);
+	CHECK(edges == glm::vec3(maxSpeed, -maxSpeed, maxSpeed));
+	glm::vec3 clamped = Game::DequantizeVelocity(Game::QuantizeVelocity(glm::vec3(-maxSpeed * 2.f, maxSpeed * 2.f, -maxSpeed * 2.f), maxSpeed), maxSpeed);
+	CHECK(clamped == glm::vec3(-maxSpeed, maxSpeed, -maxSpeed));
+	CHECK(Game::DequantizeVelocity(Game::QuantizeVelocity(glm::vec3(0.f), maxSpeed), maxSpeed) == glm::vec3(0.f));
+}
+
+// angle between two rotations in radians, q and -q are the same rotation
+static float AngleBetween(const glm::quat& a, const glm::quat& b)
+{
+	float d = glm::min(1.f, glm::abs(glm::dot(glm::normalize(a), glm::normalize(b))));
+	return 2.f * glm::acos(d);
+}
+
+static void TestOrientation()
+{
+	// each of the three sent components is off by at most half a 10 bit step over [-1/sqrt(2), 1/sqrt(2)], the
+	// largest is rebuilt from them. together that is well below half a degree
+	const float maxAngle = glm::radians(0.5f);
+	float maxError = 0.f;
+
+	std::vector<glm::quat> orientations = {
+		glm::quat(1.f, 0.f, 0.f, 0.f),
+		glm::quat(-1.f, 0.f, 0.f, 0.f),
+		glm::quat(0.f, 1.f, 0.f, 0.f),
+		glm::quat(0.f, 0.f, -1.f, 0.f),
+		glm::quat(0.f, 0.f, 0.f, -1.f),
+		// two components tie for the largest, the others sit on the bound of the field
+		glm::normalize(glm::quat(1.f, 1.f, 0.f, 0.f)),
+		glm::normalize(glm::quat(-1.f, 0.f, 1.f, 0.f)),
+		glm::normalize(glm::quat(0.f, 0.f, -1.f, -1.f)),
+		glm::quat(0.5f, -0.5f, 0.5f, -0.5f),
+		glm::quat(-0.5f, -0.5f, -0.5f, -0.5f),
+	};
+
+	// the largest component negative in every position, and random rotations of both signs
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> small(-0.4f, 0.4f);
+	for (int largest = 0; largest < 4; largest++)
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c[4] = { small(rng), small(rng), small(rng), small(rng) };
+			c[largest] = -1.f;
+			orientations.push_back(glm::normalize(glm::quat(c[3], c[0], c[1], c[2])));
+		}
+	}
+	std::normal_distribution<float> normal;
+	for (int i = 0; i < 20000; i++)
+		orientations.push_back(glm::normalize(glm::quat(normal(rng), normal(rng), normal(rng), normal(rng))));
+
+	for (const glm::quat& orientation : orientations)
+	{
+		glm::quat result = Game::DequantizeOrientation(Game::QuantizeOrientation(orientation));
+		CHECK(glm::abs(glm::length(result) - 1.f) < 1e-5f);
+		maxError = glm::max(maxError, AngleBetween(orientation, result));
+	}
+	CHECK_FMT(maxError <= maxAngle, "max error %g degrees", glm::degrees(maxError));
+
+	// an unnormalized input is the same rotation
+	glm::quat scaled = Game::DequantizeOrientation(Game::QuantizeOrientation(glm::quat(3.f, 0.f, 0.f, 0.f)));
+	CHECK(AngleBetween(scaled, glm::quat(1.f, 0.f, 0.f, 0.f)) <= maxAngle);
+}
+
+int
+main()
+{
+	for (float worldBound : { 1.f, 1024.f, 4096.f })
+		TestPosition(worldBound);
+
+	for (float maxSpeed : { 1.f, 4.f, 50.f })
+		TestVelocity(maxSpeed);
+
+	TestOrientation();
+
+	std::printf("test_quantize: %d failed\n", failedChecks);
+	return failedChecks;
+}